@@ -1,52 +1,302 @@
 #include "panclexer.hpp"
 #include "pancparser.hpp"
-#include "pancvar.hpp"
+#include "panccursor.hpp"
+#include "panccontext.hpp"
+#include "pancsource.hpp"
+#include "pancdump.hpp"
+#include "pancexec.hpp"
+#include "pancir.hpp"
+#include "pancopt.hpp"
+#include "pancvm.hpp"
+#include "pancforth.hpp"
+#include "pancjit.hpp"
+#include "pancemit.hpp"
+#include "pancpool.hpp"
+#include "pancscan.hpp"
 #include <iostream>
-#include <fstream>
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <cstddef>
+#include <sstream>
+#include <thread>
 
 static bool isVerbose{ false };
+static bool dumpBinary{ false };
+static bool checkLexer{ false };
+static bool checkMemory{ false };
+static bool dumpIR{ false };
+static bool optimizeIR{ false };
+static bool treeWalk{ false };
+static bool useJit{ false };
+static bool checkJit{ false };
+static bool emitSource{ false };
+static unsigned jobs{ 1 };
+
+// Runs the program under the tree-walking interpreter and again as native code,
+// each with standard output captured, and fails unless both runs agree.
+static bool differentialCheck(panc::Program const& program, panc::Bytecode const& bytecode,
+    panc::JitProgram const& jit, panc::StringTable const& strings)
+{
+    std::ostringstream interpreted{}, native{};
+    std::streambuf* const console{ std::cout.rdbuf(interpreted.rdbuf()) };
+    bool const interpretedOk{ panc::execute(program, strings) };
+    std::cout.rdbuf(native.rdbuf());
+    bool const nativeOk{ panc::jitRun(jit, bytecode, strings) };
+    std::cout.rdbuf(console);
+
+    std::cout << native.str();
+    if (interpretedOk != nativeOk || interpreted.str() != native.str())
+    {
+        std::cerr << "JIT check failed: native run " << (nativeOk ? "succeeded" : "failed") << " where the interpreter "
+            << (interpretedOk ? "succeeded" : "failed") << ", output " << (interpreted.str() == native.str() ? "matches" : "differs") << '\n';
+        return false;
+    }
+    std::cerr << "JIT check passed\n";
+    return true;
+}
+
+// Reads an IR file back, rebuilds a tree from each root and flattens those
+// again, failing unless both the file and the rebuilt trees match what was written.
+static bool irRoundTrip(panc::ExprPool const& written, char const* path, panc::StringTable const& strings)
+{
+    panc::SourceBuffer file{};
+    panc::Arena memory{};
+    panc::StringTable names{ memory };
+    panc::ExprPool read{}, rebuilt{};
+    if (!file.open(path) || !read.read(file.data(), file.size(), names)) return false;
+    for (std::size_t i{ 0 }; i < read.rootCount(); ++i)
+    {
+        panc::Expr const* const root{ read.toExpr(read.root(i), memory) };
+        if (!root) return false;
+        rebuilt.add(*root);
+    }
+    return read == written && rebuilt == written && names.size() == strings.size();
+}
+
+// Runs the selected run scanners from every offset of the source, and the quote
+// finders from just after every quote, failing unless each stops where the
+// scalar version does.
+static bool scannerCheck(char const* text, std::size_t size)
+{
+    panc::scan::Kernels const& fast{ panc::scan::kernels() };
+    panc::scan::Kernels const& scalar{ panc::scan::scalarKernels() };
+    char const* const end{ text + size };
+    for (char const* p{ text }; p < end; ++p)
+    {
+        bool same{ fast.skipSpace(p, end) == scalar.skipSpace(p, end)
+            && fast.skipIdent(p, end) == scalar.skipIdent(p, end)
+            && fast.skipDigits(p, end) == scalar.skipDigits(p, end) };
+        if (p > text && (p[-1] == '\'' || p[-1] == '"'))
+            same = same && fast.findQuote(p, end, '\'') == scalar.findQuote(p, end, '\'')
+                && fast.findQuote(p, end, '"') == scalar.findQuote(p, end, '"');
+        if (!same)
+        {
+            std::cerr << "Lexer check failed: the " << fast.name << " scanners differ from the scalar ones at offset " << p - text << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
+// Maps and frees pool and arena blocks of sizes that are not whole pages, many
+// times over, and fails unless everything mapped has been given back after.
+static bool memoryCheck()
+{
+    std::size_t const before{ panc::mappedPageBytes() };
+    std::size_t const sizes[]{ 5000, 4'000'004, panc::ARENA_HUGE_PAGE_SIZE - 1, panc::ARENA_HUGE_PAGE_SIZE + 12 };
+    {
+        panc::Pool pool{};
+        panc::Arena arena{};
+        for (int round{ 0 }; round < 200; ++round)
+            for (std::size_t const bytes : sizes)
+            {
+                void* const block{ pool.allocate(bytes) };
+                if (!block || !arena.allocateBytes(bytes, alignof(std::max_align_t)))
+                {
+                    std::cerr << "Memory check failed: out of memory\n";
+                    return false;
+                }
+                pool.release(block, bytes);
+                arena.reset();
+            }
+        if (pool.mappedBytes() != 0)
+        {
+            std::cerr << "Memory check failed: the pool still maps " << pool.mappedBytes() << " bytes\n";
+            return false;
+        }
+    }
+    if (panc::mappedPageBytes() != before)
+    {
+        std::cerr << "Memory check failed: " << panc::mappedPageBytes() - before << " bytes still mapped\n";
+        return false;
+    }
+    return true;
+}
 
 int main(int argc, char* argv[])
 {
     if (argc < 2)
     {
-        std::cerr << "Usage: pancakesC [--verbose] <files.cakes>\n";
+        std::cerr << "Usage: pancakesC [--verbose] [--dump-binary] [--jobs N] [--check-lexer] [--check-memory] [--dump-ir] [--optimize] [--tree-walk] [--jit] [--jit-check] [--emit-c] <files.cakes | ->\n";
         return 1;
     }
     char const* filePath{ nullptr };
     for (int i{ 1 }; i < argc; ++i)
     {
         if (std::strcmp(argv[i], "--verbose") == 0) isVerbose = true;
+        else if (std::strcmp(argv[i], "--dump-binary") == 0) dumpBinary = true;
+        else if (std::strcmp(argv[i], "--check-lexer") == 0) checkLexer = true;
+        else if (std::strcmp(argv[i], "--check-memory") == 0) checkMemory = true;
+        else if (std::strcmp(argv[i], "--dump-ir") == 0) dumpIR = true;
+        else if (std::strcmp(argv[i], "--optimize") == 0) optimizeIR = true;
+        else if (std::strcmp(argv[i], "--tree-walk") == 0) treeWalk = true;
+        else if (std::strcmp(argv[i], "--jit") == 0) useJit = true;
+        else if (std::strcmp(argv[i], "--jit-check") == 0) checkJit = true;
+        else if (std::strcmp(argv[i], "--emit-c") == 0) emitSource = true;
+        else if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+        {
+            jobs = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+            if (jobs == 0) jobs = std::max(1u, std::thread::hardware_concurrency());
+        }
         else filePath = argv[i];
     }
     if (!filePath)
     {
-        std::cerr << "Usage: pancakesC [--verbose] <files.cakes>\n";
+        std::cerr << "Usage: pancakesC [--verbose] [--dump-binary] [--jobs N] [--check-lexer] [--check-memory] [--dump-ir] [--optimize] [--tree-walk] [--jit] [--jit-check] [--emit-c] <files.cakes | ->\n";
         return 1;
     }
 
-    std::ifstream in{ filePath, std::ios::binary | std::ios::ate };
-    if (!in)
+    panc::SourceBuffer source{};
+    if (!source.open(filePath))
+    {
+        std::cerr << "Failed to open " << filePath << " for reading.\n";
+        return 1;
+    }
+    if (source.size() > panc::MAX_SOURCE_SIZE)
     {
-        std::cerr << "Failed to open " << filePath << "for reading.\n";
+        std::cerr << filePath << " is too large; sources are limited to 4 GiB.\n";
         return 1;
     }
-    std::streampos const sz{ in.tellg() };
-    if (sz <= 0 || sz > static_cast<std::streamsize>(panc::MAX_INPUT_SIZE)) return 1;
-    in.seekg(0);
-    in.read(parser::inputBuffer, sz);
-    parser::inputBuffer[sz] = '\0';
 
-    Lexer lexer{ parser::inputBuffer, static_cast<std::size_t>(sz) };
-    if (isVerbose)
+    Lexer lexer{ source };
+    panc::CompilationContext context{ source };
+    panc::LineTable const& lines{ context.lines };
+    panc::TokenBuffer& tokens{ context.tokens };
+    if (checkLexer)
     {
-        lexer >> filePath;
-        std::cout << lexer << '\n';
+        if (!scannerCheck(source.data(), source.size())) return 1;
+        panc::TokenBuffer serial{ source.data() }, parallel{ source.data() };
+        Lexer{ source }.tokenizeInto(serial);
+        Lexer{ source }.tokenizeParallel(parallel, std::max(jobs, 4u), source.size() / 64 + 1);
+        if (!(serial == parallel))
+        {
+            std::cerr << "Lexer check failed: parallel tokens differ from serial tokens\n";
+            return 1;
+        }
     }
-    std::size_t tokenCount{ lexer.tokenizeInto(parser::tokens, panc::MAX_TOKENS) };
+    if (checkMemory && !memoryCheck()) return 1;
+    if (isVerbose || dumpBinary || jobs > 1)
+    {
+        lexer.tokenizeParallel(tokens, jobs);
+        char dumpPath[512]{};
+        if (isVerbose)
+        {
+            panc::tokenDumpPath(dumpPath, sizeof(dumpPath), filePath, "Token.txt");
+            panc::BufferedWriter file{ dumpPath };
+            if (file.ok()) panc::writeTokenText(tokens, lines, file);
+            if (!file.ok() || !file.close())
+            {
+                std::cerr << "Failed to write " << dumpPath << '\n';
+                return 1;
+            }
+            panc::BufferedWriter out{ stdout };
+            panc::writeTokenText(tokens, lines, out);
+            out.put('\n');
+            if (!out.close())
+            {
+                std::cerr << "Failed to write the token dump to standard output\n";
+                return 1;
+            }
+        }
+        if (dumpBinary)
+        {
+            panc::tokenDumpPath(dumpPath, sizeof(dumpPath), filePath, "Token.bin");
+            if (!panc::writeTokenBinary(tokens, source.size(), dumpPath))
+            {
+                std::cerr << "Failed to write " << dumpPath << '\n';
+                return 1;
+            }
+        }
+    }
+    TokenCursor cursor{ tokens.empty() ? TokenCursor{ lexer } : TokenCursor{ tokens } };
 
-    Parser parser{ parser::tokens, tokenCount };
-    return parser.run() ? 0 : 1;
+    panc::StringTable const& strings{ context.strings };
+    Parser parser{ cursor, context };
+    panc::Program* const program{ parser.parse() };
+    if (!program || parser.hasErrors()) return 1;
+    if (optimizeIR)
+    {
+        panc::OptimizeStats const stats{ panc::optimize(*program) };
+        std::cerr << "Optimizer: removed " << stats.removed() << " of " << stats.nodesBefore << " expression nodes ("
+            << stats.folded << " folded, " << stats.shared << " shared)\n";
+    }
+    if (dumpIR)
+    {
+        panc::ExprPool pool{};
+        panc::flattenProgram(*program, pool);
+        char irPath[512]{};
+        panc::tokenDumpPath(irPath, sizeof(irPath), filePath, "IR.bin");
+        if (!pool.write(irPath, strings))
+        {
+            std::cerr << "Failed to write " << irPath << '\n';
+            return 1;
+        }
+        if (!irRoundTrip(pool, irPath, strings))
+        {
+            std::cerr << "IR check failed: " << irPath << " does not read back as the IR written\n";
+            return 1;
+        }
+    }
+    panc::ForthProgram forth{};
+    if (!panc::compileForth(*program, strings, forth)) return 1;
+    // Compiling to bytecode is the semantic check for every engine, so they all
+    // reject the same programs; the tree walker and the C are run and written from the tree.
+    panc::Bytecode bytecode{};
+    if (!panc::compile(*program, strings, bytecode)) return 1;
+    if (emitSource)
+    {
+        if (!panc::canEmitC(*program, strings)) return 1;
+        char cPath[512]{};
+        panc::tokenDumpPath(cPath, sizeof(cPath), filePath, ".c");
+        panc::BufferedWriter file{ cPath };
+        if (!file.ok())
+        {
+            std::cerr << "Failed to write " << cPath << '\n';
+            return 1;
+        }
+        panc::emitC(*program, forth, strings, file);
+        if (!file.close())
+        {
+            std::cerr << "Failed to write " << cPath << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    if (!forth.entries.empty())
+    {
+        bool const ran{ panc::runForth(forth) };
+        std::cout << '\n';
+        if (!ran) return 1;
+    }
+    if (treeWalk)
+        return panc::execute(*program, strings) ? 0 : 1;
+    if (useJit || checkJit)
+    {
+        panc::JitProgram jit{};
+        if (!panc::jitCompile(bytecode, jit)) return 1;
+        if (checkJit) return differentialCheck(*program, bytecode, jit, strings) ? 0 : 1;
+        return panc::jitRun(jit, bytecode, strings) ? 0 : 1;
+    }
+    return panc::run(bytecode, strings) ? 0 : 1;
 }
@@ -0,0 +1,205 @@
+#include "pancarena.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace panc
+{
+    namespace
+    {
+        constexpr std::size_t round_up(std::size_t value, std::size_t align)
+        {
+            return (value + align - 1) / align * align;
+        }
+
+        // The kernel's page size, which is 16 or 64 KiB on some ARM systems.
+        std::size_t pageSize()
+        {
+#ifdef _WIN32
+            static std::size_t const size{ []
+            {
+                SYSTEM_INFO info{};
+                GetSystemInfo(&info);
+                return static_cast<std::size_t>(info.dwPageSize);
+            }() };
+#else
+            static std::size_t const size{ static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) };
+#endif
+            return size;
+        }
+
+        std::atomic<std::size_t> mappedTotal{ 0 };
+
+        // Giving back pages this file mapped only fails if the bookkeeping is
+        // wrong, and carrying on would leak them silently.
+        void release(void* pages, std::size_t bytes)
+        {
+#ifdef _WIN32
+            bool const ok{ VirtualFree(pages, 0, MEM_RELEASE) != 0 };
+#else
+            bool const ok{ munmap(pages, bytes) == 0 };
+#endif
+            if (!ok)
+            {
+                std::cerr << "Runtime Error: failed to return memory to the OS\n";
+                std::abort();
+            }
+            mappedTotal -= bytes;
+        }
+    }
+
+    Arena::~Arena()
+    {
+        reset();
+        while (spare)
+        {
+            Block* const next{ spare->prev };
+            unmapPages(spare, spare->size);
+            spare = next;
+        }
+    }
+
+    bool Arena::grow(std::size_t bytes)
+    {
+        if (bytes > SIZE_MAX - sizeof(Block) - ARENA_HUGE_PAGE_SIZE) return false;
+        std::size_t const need{ sizeof(Block) + bytes };
+
+        Block* b{ nullptr };
+        for (Block** link{ &spare }; *link; link = &(*link)->prev)
+            if ((*link)->size >= need)
+            {
+                b = *link;
+                *link = b->prev;
+                break;
+            }
+        if (!b)
+        {
+            std::size_t const size{ std::max(nextSize, round_up(need, need >= ARENA_HUGE_PAGE_SIZE ? ARENA_HUGE_PAGE_SIZE : pageSize())) };
+            void* const pages{ mapPages(size) };
+            if (!pages) return false;
+            b = new (pages) Block{ nullptr, size, nullptr };
+            // An oversized request gets a block of its own size without skipping the doubling.
+            if (size == nextSize) nextSize = std::min(nextSize * 2, ARENA_MAX_BLOCK_SIZE);
+        }
+
+        if (current) retired += static_cast<std::size_t>(cursor - payload(current));
+        b->prev = current;
+        b->destructors = end(b);
+        current = b;
+        cursor = payload(b);
+        limit = b->destructors;
+        return true;
+    }
+
+    // Defining PANC_ARENA_HUGETLB first asks for reserved huge pages (MAP_HUGETLB,
+    // or MEM_LARGE_PAGES on Windows) for lengths of whole huge pages, which the OS
+    // can give back at the same length, falling back when none are free.
+    void* mapPages(std::size_t bytes)
+    {
+        // Every length is whole pages, so the trimmed tail starts on a page boundary.
+        if (bytes > SIZE_MAX - ARENA_HUGE_PAGE_SIZE) return nullptr;
+        bytes = round_up(bytes, pageSize());
+        bool const huge{ bytes >= ARENA_HUGE_PAGE_SIZE };
+        void* p{ nullptr };
+#ifdef _WIN32
+#ifdef PANC_ARENA_HUGETLB
+        std::size_t const large{ GetLargePageMinimum() };
+        if (huge && large && bytes % large == 0)
+            p = VirtualAlloc(nullptr, bytes, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+#endif
+        if (!p) p = VirtualAlloc(nullptr, bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (p) mappedTotal += bytes;
+#else
+#if defined(PANC_ARENA_HUGETLB) && defined(MAP_HUGETLB)
+        if (huge && bytes % ARENA_HUGE_PAGE_SIZE == 0)
+        {
+            int flags{ MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB };
+#ifdef MAP_HUGE_SHIFT
+            // Ask for pages of exactly this size rather than the kernel's default.
+            flags |= std::countr_zero(ARENA_HUGE_PAGE_SIZE) << MAP_HUGE_SHIFT;
+#endif
+            p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (p == MAP_FAILED) p = nullptr;
+            else mappedTotal += bytes;
+        }
+#endif
+        if (!p)
+        {
+            // Over-map by one huge page and trim both ends to align the block.
+            std::size_t const mapped{ huge ? bytes + ARENA_HUGE_PAGE_SIZE : bytes };
+            void* const raw{ mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) };
+            if (raw == MAP_FAILED) return nullptr;
+            mappedTotal += mapped;
+            p = raw;
+            if (huge)
+            {
+                std::byte* const base{ static_cast<std::byte*>(raw) };
+                std::byte* const aligned{ reinterpret_cast<std::byte*>(round_up(reinterpret_cast<std::uintptr_t>(base), ARENA_HUGE_PAGE_SIZE)) };
+                if (aligned > base) release(base, static_cast<std::size_t>(aligned - base));
+                if (base + mapped > aligned + bytes) release(aligned + bytes, static_cast<std::size_t>(base + mapped - (aligned + bytes)));
+                p = aligned;
+#ifdef MADV_HUGEPAGE
+                madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+            }
+        }
+#endif
+        (void)huge;
+        return p;
+    }
+
+    void unmapPages(void* pages, std::size_t bytes)
+    {
+        release(pages, round_up(bytes, pageSize()));
+    }
+
+    std::size_t mappedPageBytes()
+    {
+        return mappedTotal;
+    }
+
+    void Arena::run_destructors(std::byte* first, std::byte* last)
+    {
+        for (DestructorEntry* it{ reinterpret_cast<DestructorEntry*>(first) }; it < reinterpret_cast<DestructorEntry*>(last); ++it)
+            it->destroy(it->ptr, it->count);
+    }
+
+    void Arena::rewind(Marker const& m)
+    {
+        while (current != m.block)
+        {
+            run_destructors(current->destructors, end(current));
+            Block* const prev{ current->prev };
+            current->prev = spare;
+            spare = current;
+            current = prev;
+        }
+        if (current)
+        {
+            run_destructors(current->destructors, m.limit);
+            current->destructors = m.limit;
+        }
+        cursor = m.cursor;
+        limit = m.limit;
+        retired = m.retired;
+    }
+
+    std::size_t Arena::capacity() const
+    {
+        std::size_t total{ 0 };
+        for (Block* b{ current }; b; b = b->prev)
+            total += static_cast<std::size_t>(end(b) - payload(b));
+        return total;
+    }
+}
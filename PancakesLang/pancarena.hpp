@@ -6,18 +6,59 @@
 #include <type_traits>
 #include <new>
 #include <utility>
-#include "pancarray.hpp"
 #include "pancdef.hpp"
 
 namespace panc
 {
+    // Memory straight from the OS, or nullptr when it refuses. Sizes are rounded
+    // up to whole pages. Mappings of ARENA_HUGE_PAGE_SIZE or more are huge-page
+    // aligned and, on Linux, advised for transparent huge pages; unmapPages
+    // takes the size mapPages was given and aborts if the OS will not take the
+    // pages back.
+    void* mapPages(std::size_t bytes);
+    void unmapPages(void* pages, std::size_t bytes);
+    // Bytes mapPages has mapped and not yet given back, over the whole process.
+    std::size_t mappedPageBytes();
+
+    // Bump allocator over a chain of blocks mapped from the OS. Each block is
+    // filled upwards with objects and downwards with the destructor entries of
+    // the non-trivial ones; when the two meet, the next block is chained on, each
+    // twice the size of the last up to ARENA_MAX_BLOCK_SIZE. reset() runs every
+    // destructor, newest first, and keeps the blocks for reuse; only the
+    // destructor gives them back. Allocation returns nullptr once the OS refuses
+    // another block.
     struct Arena
     {
-        alignas(std::max_align_t)
-            panc::array<std::byte, MAX_CAPACITY_SIZE> memory{};
+    private:
+        struct Block;
 
-        std::size_t offset{};
-        std::size_t dstack_offset{ MAX_CAPACITY_SIZE };
+    public:
+        // Where the arena stood when mark() was called. Markers are rewound in
+        // LIFO order; one taken before an earlier rewind target is still valid,
+        // one taken after it is not.
+        struct Marker
+        {
+            Block* block;
+            std::byte* cursor;
+            std::byte* limit;
+            std::size_t retired;
+        };
+
+        // Frees everything allocated in the enclosing C++ scope on the way out,
+        // on every path, unless commit() was called to keep it.
+        class Scope
+        {
+            Arena& arena;
+            Marker const marker;
+            bool committed{ false };
+
+        public:
+            explicit Scope(Arena& a) : arena(a), marker(a.mark()) {}
+            ~Scope() { if (!committed) arena.rewind(marker); }
+            void commit() { committed = true; }
+            Scope(Scope const&) = delete;
+            Scope& operator=(Scope const&) = delete;
+        };
 
     private:
         struct DestructorEntry
@@ -27,6 +68,21 @@ namespace panc
             std::size_t count;
         };
 
+        // Header at the start of every block; the payload follows it.
+        struct alignas(std::max_align_t) Block
+        {
+            Block* prev;
+            std::size_t size;
+            std::byte* destructors;
+        };
+
+        Block* current{ nullptr };
+        Block* spare{ nullptr };
+        std::byte* cursor{ nullptr };
+        std::byte* limit{ nullptr };
+        std::size_t nextSize{ ARENA_FIRST_BLOCK_SIZE };
+        std::size_t retired{ 0 };
+
         template <typename U>
         static void destroy_range(void* p, std::size_t n)
         {
@@ -35,53 +91,74 @@ namespace panc
                 up[i].~U();
         }
 
-        static constexpr std::size_t align_down(std::size_t val, std::size_t align)
+        static constexpr std::uintptr_t align_down(std::uintptr_t val, std::size_t align)
         {
-            return val & ~(align - 1);
+            return val & ~(std::uintptr_t{ align } - 1);
         }
 
-        bool push_destructor(DestructorEntry const& entry)
+        static std::byte* payload(Block* b)
         {
-            std::size_t const entrySize{ sizeof(DestructorEntry) };
-            std::size_t const align{ alignof(DestructorEntry) };
-            std::size_t new_doffset{ dstack_offset };
-            if (new_doffset < entrySize)
-                return false;
-            new_doffset -= entrySize;
-            new_doffset = align_down(new_doffset, align);
-            if (offset > new_doffset)
-                return false;
-            dstack_offset = new_doffset;
-            DestructorEntry* dest{ reinterpret_cast<DestructorEntry*>(memory.data + dstack_offset) };
-            *dest = entry;
-            return true;
+            return reinterpret_cast<std::byte*>(b + 1);
         }
 
-    public:
-        Arena() : offset{}, dstack_offset{ MAX_CAPACITY_SIZE } {}
+        static std::byte* end(Block* b)
+        {
+            return reinterpret_cast<std::byte*>(b) + b->size;
+        }
 
-        ~Arena()
+        // The common case: room between cursor and the destructor stack.
+        void* bump(std::size_t size, std::size_t align)
+        {
+            std::uintptr_t const start{ align_down(reinterpret_cast<std::uintptr_t>(cursor) + align - 1, align) };
+            std::uintptr_t const top{ reinterpret_cast<std::uintptr_t>(limit) };
+            if (start > top || size > top - start)
+            {
+                if (!grow(size + align - 1)) return nullptr;
+                return bump(size, align);
+            }
+            cursor = reinterpret_cast<std::byte*>(start + size);
+            return reinterpret_cast<void*>(start);
+        }
+
+        bool push_destructor(DestructorEntry const& entry)
         {
-            reset();
+            std::uintptr_t top{ align_down(reinterpret_cast<std::uintptr_t>(limit) - sizeof(DestructorEntry), alignof(DestructorEntry)) };
+            if (top < reinterpret_cast<std::uintptr_t>(cursor))
+            {
+                if (!grow(sizeof(DestructorEntry))) return false;
+                top = align_down(reinterpret_cast<std::uintptr_t>(limit) - sizeof(DestructorEntry), alignof(DestructorEntry));
+            }
+            limit = reinterpret_cast<std::byte*>(top);
+            current->destructors = limit;
+            new (limit) DestructorEntry{ entry };
+            return true;
         }
 
+        // Makes a block with at least bytes of payload current: a spare one if
+        // one is big enough, otherwise a new one.
+        bool grow(std::size_t bytes);
+        static void run_destructors(std::byte* first, std::byte* last);
+
+    public:
+        Arena() = default;
+        Arena(Arena const&) = delete;
+        Arena& operator=(Arena const&) = delete;
+        ~Arena();
+
         template<typename T, typename... Args>
         T* allocateTrivial(Args&&... args)
         {
             static_assert(std::is_trivially_destructible_v<T>,
                 "allocateTrivial only supports trivially destructible types");
 
-            std::size_t const align{ alignof(T) };
-            std::uintptr_t const base{ reinterpret_cast<std::uintptr_t>(memory.data) + offset };
-            std::size_t const adjust{ (align - (base % align)) % align };
-            std::size_t const newOffset{ offset + adjust + sizeof(T) };
-
-            if (newOffset > dstack_offset)
-                return nullptr;
+            void* const raw{ bump(sizeof(T), alignof(T)) };
+            return raw ? new (raw) T(std::forward<Args>(args)...) : nullptr;
+        }
 
-            std::byte* raw{ memory.data + offset + adjust };
-            offset = newOffset;
-            return new (raw) T(std::forward<Args>(args)...);
+        // Uninitialised storage for variable-size trivial records.
+        void* allocateBytes(std::size_t size, std::size_t align)
+        {
+            return bump(size, align);
         }
 
         template<typename T, typename... Args>
@@ -90,17 +167,10 @@ namespace panc
             static_assert(std::is_nothrow_constructible_v<T, Args...>,
                 "Arena allocation requires nothrow-constructible types in freestanding mode");
 
-            std::size_t const align{ alignof(T) };
-            std::uintptr_t const base{ reinterpret_cast<std::uintptr_t>(memory.data) + offset };
-            std::size_t const adjust{ (align - (base % align)) % align };
-            std::size_t const newOffset{ offset + adjust + sizeof(T) };
-
-            if (newOffset > dstack_offset)
+            void* const raw{ bump(sizeof(T), alignof(T)) };
+            if (!raw)
                 return nullptr;
 
-            std::byte* raw{ memory.data + offset + adjust };
-            offset = newOffset;
-
             T* obj{ new (raw) T(std::forward<Args>(args)...) };
 
             if constexpr (!std::is_trivially_destructible_v<T>)
@@ -109,7 +179,7 @@ namespace panc
                 if (!push_destructor(entry))
                 {
                     obj->~T();
-                    offset -= (adjust + sizeof(T));
+                    cursor = static_cast<std::byte*>(raw);
                     return nullptr;
                 }
             }
@@ -120,23 +190,16 @@ namespace panc
         template<typename T, typename... Args>
         T* allocateArray(std::size_t count, Args&&... args)
         {
-            if (count == 0)
+            if (count == 0 || count > SIZE_MAX / sizeof(T))
                 return nullptr;
 
             static_assert(std::is_nothrow_constructible_v<T, Args...>,
                 "Arena allocation requires nothrow-constructible types in freestanding mode");
 
-            std::size_t const align{ alignof(T) };
-            std::uintptr_t const base{ reinterpret_cast<std::uintptr_t>(memory.data) + offset };
-            std::size_t const adjust{ (align - (base % align)) % align };
-            std::size_t const totalSize{ sizeof(T) * count };
-
-            if (offset + adjust + totalSize > dstack_offset)
+            std::byte* const raw{ static_cast<std::byte*>(bump(sizeof(T) * count, alignof(T))) };
+            if (!raw)
                 return nullptr;
 
-            std::byte* raw{ memory.data + offset + adjust };
-            offset += adjust + totalSize;
-
             T* start{ reinterpret_cast<T*>(raw) };
             for (std::size_t i{ 0 }; i < count; ++i)
                 new (raw + i * sizeof(T)) T(std::forward<Args>(args)...);
@@ -148,7 +211,7 @@ namespace panc
                 {
                     for (std::size_t i{ count }; i-- > 0; )
                         start[i].~T();
-                    offset -= (adjust + totalSize);
+                    cursor = raw;
                     return nullptr;
                 }
             }
@@ -156,28 +219,28 @@ namespace panc
             return start;
         }
 
-        void reset()
+        Marker mark() const
         {
-            DestructorEntry* it{ reinterpret_cast<DestructorEntry*>(memory.data + dstack_offset) };
-            DestructorEntry* const end{ reinterpret_cast<DestructorEntry*>(memory.data + MAX_CAPACITY_SIZE) };
-            while (it < end)
-            {
-                it->destroy(it->ptr, it->count);
-                ++it;
-            }
-            offset = 0;
-            dstack_offset = MAX_CAPACITY_SIZE;
+            return { current, cursor, limit, retired };
         }
 
-        std::size_t used() const
+        // Runs the destructors registered since m, newest first, and frees what
+        // was allocated since; blocks chained on since then go back to the spares.
+        void rewind(Marker const& m);
+
+        void reset()
         {
-            return offset;
+            rewind(Marker{});
         }
 
-        std::size_t capacity() const
+        // Bytes handed out since the last reset, alignment padding included.
+        std::size_t used() const
         {
-            return MAX_CAPACITY_SIZE;
+            return retired + (current ? static_cast<std::size_t>(cursor - payload(current)) : 0);
         }
+
+        // Payload bytes of the blocks in use.
+        std::size_t capacity() const;
     };
 }
 
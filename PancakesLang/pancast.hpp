@@ -0,0 +1,178 @@
+#ifndef PANCAST_HPP
+#define PANCAST_HPP
+
+#include "pancexpr.hpp"
+#include <cstdint>
+
+namespace panc
+{
+    enum class StmtKind : uint8_t
+    {
+        CALL,
+        ASSIGN,
+        PUSH,
+        FOR,
+        DESTROY
+    };
+
+    struct Stmt
+    {
+        StmtKind kind;
+        uint32_t offset;
+        Stmt* next;
+
+        union
+        {
+            struct
+            {
+                Expr* expr;
+            } call;
+
+            struct
+            {
+                Expr* target;
+                Expr* value;
+            } assign;
+
+            struct
+            {
+                Expr* value;
+            } push;
+
+            // Counts var_idx from first to last inclusive; both bounds are evaluated
+            // once, and compile() rejects a body that assigns var_idx itself.
+            struct
+            {
+                Expr* first;
+                Expr* last;
+                Stmt* body;
+                uint32_t var_idx;
+            } loop;
+
+            // Discards the top of the type_idx value stack.
+            struct
+            {
+                uint32_t type_idx;
+            } destroy;
+        };
+    };
+
+    struct Param
+    {
+        uint32_t name_idx;
+        uint32_t type_idx;
+        Param* next;
+    };
+
+    // Locals declared in a "local" block are Params too, and start at zero.
+    struct Procedure
+    {
+        uint32_t name_idx;
+        uint32_t offset;
+        bool isMain;
+        uint32_t param_count;
+        Param* params;
+        uint32_t local_count;
+        Param* locals;
+        Stmt* body;
+        Procedure* next;
+    };
+
+    enum class ForthWordKind : uint8_t
+    {
+        LITERAL,
+        NAME,
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        EQ,
+        LT,
+        GT,
+        STORE,
+        FETCH,
+        PRINT
+    };
+
+    // One word of a forth block: a number, a name left for the Forth compiler to
+    // resolve, or a primitive spelled with punctuation.
+    struct ForthWord
+    {
+        ForthWordKind kind;
+        uint32_t offset;
+        int32_t value;
+    };
+
+    struct ForthBlock
+    {
+        uint32_t offset;
+        uint32_t word_count;
+        ForthWord* words;
+        ForthBlock* next;
+    };
+
+    // byte_offset is the field's place within one element; sizes are in bytes.
+    struct StructField
+    {
+        uint32_t name_idx;
+        uint32_t type_idx;
+        uint32_t byte_offset;
+        uint32_t size;
+        bool has_init;
+        double init;
+        StructField* next;
+    };
+
+    // Laid out as C would: fields in declaration order at their natural
+    // alignment, and size rounded up to the largest of them.
+    struct Structure
+    {
+        uint32_t name_idx;
+        uint32_t offset;
+        uint32_t field_count;
+        uint32_t size;
+        uint32_t align;
+        StructField* fields;
+        Structure* next;
+    };
+
+    // A class variable takes one cell; one declared in a manual block takes the
+    // cells it allocates, and starts at init. Pinned variables are never moved
+    // or reclaimed. An array of count structures is stored element by element,
+    // or with soa set, as one array per field.
+    struct ClassVar
+    {
+        uint32_t name_idx;
+        uint32_t type_idx;
+        uint32_t offset;
+        uint32_t cells;
+        int32_t init;
+        bool pinned;
+        bool soa;
+        Structure const* structure;
+        uint32_t count;
+        ClassVar* next;
+    };
+
+    struct Class
+    {
+        uint32_t name_idx;
+        uint32_t offset;
+        uint32_t var_count;
+        uint32_t cell_count;
+        Structure* structures;
+        ClassVar* vars;
+        ForthBlock* forth;
+        Class* next;
+    };
+
+    struct Program
+    {
+        Procedure* procedures;
+        Procedure* main;
+        uint32_t procedure_count;
+        Class* classes;
+    };
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef PANCCONTEXT_HPP
+#define PANCCONTEXT_HPP
+
+#include "pancarena.hpp"
+#include "pancarray.hpp"
+#include "pancdef.hpp"
+#include "pancexpr.hpp"
+#include "pancsource.hpp"
+#include "panctokens.hpp"
+#include "pancutil.hpp"
+#include <cstddef>
+
+namespace panc
+{
+    // Everything one compilation owns: syntax tree and name storage, tokens, the
+    // line table and syntax errors. Nothing is shared between contexts, so each
+    // thread may compile its own source. The source text must outlive the context.
+    struct CompilationContext
+    {
+        Arena nodes{};
+        Arena names{};
+        StringTable strings{ names };
+        TokenBuffer tokens;
+        LineTable const lines;
+        array<SyntaxError, MAX_SYNTAX_ERRORS> syntaxErrors{};
+
+        CompilationContext(char const* src, std::size_t len) : tokens{ src }, lines{ src, len } {}
+        explicit CompilationContext(SourceBuffer const& source) : CompilationContext(source.data(), source.size()) {}
+        CompilationContext(CompilationContext const&) = delete;
+        CompilationContext& operator=(CompilationContext const&) = delete;
+    };
+}
+
+#endif
@@ -0,0 +1,57 @@
+#include "panccursor.hpp"
+#include <cassert>
+
+static_assert((panc::MAX_LOOKAHEAD & (panc::MAX_LOOKAHEAD - 1)) == 0, "MAX_LOOKAHEAD must be a power of two");
+
+TokenCursor::TokenCursor(Lexer const& source) : origin(source), lexer(source) {}
+
+TokenCursor::TokenCursor(panc::TokenBuffer const& buffer)
+    : origin(buffer.text(), 0), lexer(buffer.text(), 0), replay(&buffer) {}
+
+panc::Token const& TokenCursor::peek(std::size_t ahead)
+{
+    assert(ahead < panc::MAX_LOOKAHEAD);
+    fill(ahead + 1);
+    return ring[(head + ahead) & (panc::MAX_LOOKAHEAD - 1)];
+}
+
+panc::Token TokenCursor::consume()
+{
+    fill(1);
+    panc::Token const t{ ring[head] };
+    if (t.type != panc::TokenType::END_OF_FILE)
+    {
+        head = (head + 1) & (panc::MAX_LOOKAHEAD - 1);
+        --buffered;
+    }
+    return t;
+}
+
+bool TokenCursor::atEnd()
+{
+    return peek().type == panc::TokenType::END_OF_FILE;
+}
+
+void TokenCursor::rewind()
+{
+    lexer = origin;
+    replayed = 0;
+    head = 0;
+    buffered = 0;
+}
+
+void TokenCursor::fill(std::size_t wanted)
+{
+    while (buffered < wanted)
+    {
+        ring[(head + buffered) & (panc::MAX_LOOKAHEAD - 1)] = pull();
+        ++buffered;
+    }
+}
+
+panc::Token TokenCursor::pull()
+{
+    if (!replay) return lexer.nextToken();
+    if (replayed < replay->size()) return (*replay)[replayed++];
+    return { panc::TokenType::END_OF_FILE, "", replay->empty() ? 0 : replay->offset(replay->size() - 1) };
+}
@@ -0,0 +1,36 @@
+#ifndef PANCCURSOR_HPP
+#define PANCCURSOR_HPP
+
+#include "panclexer.hpp"
+#include "pancdef.hpp"
+#include "pancutil.hpp"
+#include <cstddef>
+
+// Pulls tokens from the lexer on demand into a fixed ring, so the parser sees a
+// bounded window of lookahead and memory stays constant whatever the file size.
+// Can also replay a TokenBuffer that was already built (e.g. for --verbose).
+class TokenCursor
+{
+    Lexer origin;
+    Lexer lexer;
+    panc::TokenBuffer const* replay{ nullptr };
+    std::size_t replayed{ 0 };
+    panc::Token ring[panc::MAX_LOOKAHEAD]{};
+    std::size_t head{ 0 };
+    std::size_t buffered{ 0 };
+
+public:
+    explicit TokenCursor(Lexer const& source);
+    explicit TokenCursor(panc::TokenBuffer const& buffer);
+
+    panc::Token const& peek(std::size_t ahead = 0);
+    panc::Token consume();
+    bool atEnd();
+    void rewind();
+
+private:
+    void fill(std::size_t wanted);
+    panc::Token pull();
+};
+
+#endif
@@ -2,15 +2,28 @@
 #define PANCDEF_HPP
 
 #include <cstddef>
+#include <cstdint>
 
 namespace panc
 {
-    constexpr std::size_t MAX_INPUT_SIZE{ 256 * 1024 };
-    constexpr std::size_t MAX_TOKENS{ 4096 };
+    constexpr std::size_t MAX_SOURCE_SIZE{ UINT32_MAX };
+    constexpr std::size_t MAX_LOOKAHEAD{ 8 };
+    constexpr std::size_t PARALLEL_LEX_MIN_CHUNK{ 1024 * 1024 };
     constexpr std::size_t MAX_SYNTAX_ERRORS{ 256 };
     constexpr std::size_t MAX_STACK_DEPTH{ 256 };
-    constexpr std::size_t MAX_FUNC_ARGS{ 16 };
-    constexpr std::size_t MAX_CAPACITY_SIZE{ 8192 };
+    constexpr std::size_t ARENA_FIRST_BLOCK_SIZE{ 64 * 1024 };
+    constexpr std::size_t ARENA_MAX_BLOCK_SIZE{ 64 * 1024 * 1024 };
+    constexpr std::size_t ARENA_HUGE_PAGE_SIZE{ 2 * 1024 * 1024 };
+    constexpr std::size_t FORTH_STACK_SIZE{ 64 };
+    constexpr std::size_t VALUE_STACK_SIZE{ 256 };
 }
 
+// Labels-as-values is a GCC/Clang extension; MSVC gets switch-loop interpreters.
+// Define PANC_VM_SWITCH to force the switch loops everywhere.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(PANC_VM_SWITCH)
+#define PANC_THREADED_DISPATCH 1
+#else
+#define PANC_THREADED_DISPATCH 0
+#endif
+
 #endif
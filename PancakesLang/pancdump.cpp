@@ -0,0 +1,50 @@
+#include "pancdump.hpp"
+#include "pancstring.hpp"
+
+namespace panc
+{
+    void writeTokenText(TokenBuffer const& tokens, LineTable const& lines, BufferedWriter& out)
+    {
+        std::size_t line{ 1 };
+        std::size_t const lineCount{ lines.lineCount() };
+        for (std::size_t i{ 0 }; i < tokens.size(); ++i)
+        {
+            std::uint32_t const at{ tokens.offset(i) };
+            while (line < lineCount && lines.lineStart(line + 1) <= at) ++line;
+            out.put("Token Type: <");
+            out.put(TokenTypeToString(tokens.type(i)));
+            out.put("> Word: \"");
+            out.put(tokens.text() + tokens.valueOffset(i), tokens.length(i));
+            out.put("\" Position: { Line: ");
+            out.put(static_cast<std::uint64_t>(line));
+            out.put(", Column: ");
+            out.put(static_cast<std::uint64_t>(at - lines.lineStart(line) + 1));
+            out.put(" }\n");
+        }
+    }
+
+    bool writeTokenBinary(TokenBuffer const& tokens, std::size_t sourceSize, char const* path)
+    {
+        BufferedWriter out{ path };
+        if (!out.ok()) return false;
+        std::uint64_t const count{ tokens.size() };
+        TokenDumpHeader header{};
+        header.count = count;
+        header.sourceSize = sourceSize;
+        header.offsetsAt = sizeof(TokenDumpHeader);
+        header.lengthsAt = header.offsetsAt + count * sizeof(std::uint32_t);
+        header.typesAt = header.lengthsAt + count * sizeof(std::uint32_t);
+        out.put(reinterpret_cast<char const*>(&header), sizeof(header));
+        out.put(reinterpret_cast<char const*>(tokens.offsetData()), count * sizeof(std::uint32_t));
+        out.put(reinterpret_cast<char const*>(tokens.lengthData()), count * sizeof(std::uint32_t));
+        out.put(reinterpret_cast<char const*>(tokens.typeData()), count);
+        return out.close();
+    }
+
+    void tokenDumpPath(char* out, std::size_t outSize, char const* sourcePath, char const* suffix)
+    {
+        panc::strcpy(out, outSize, sourcePath);
+        if (char* dot{ panc::strrchr(out, '.') }) *dot = '\0';
+        panc::strcat(out, outSize, suffix);
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef PANCDUMP_HPP
+#define PANCDUMP_HPP
+
+#include "panctokens.hpp"
+#include "pancsource.hpp"
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+namespace panc
+{
+    class BufferedWriter
+    {
+        std::FILE* out;
+        bool owned;
+        std::size_t used{ 0 };
+        bool failed{ false };
+        char buffer[64 * 1024];
+
+    public:
+        explicit BufferedWriter(std::FILE* stream) : out(stream), owned(false) {}
+        explicit BufferedWriter(char const* path) : out(std::fopen(path, "wb")), owned(true) {}
+        BufferedWriter(BufferedWriter const&) = delete;
+        BufferedWriter& operator=(BufferedWriter const&) = delete;
+
+        ~BufferedWriter()
+        {
+            close();
+        }
+
+        // Flushes and, for a file opened here, closes it; a borrowed stream is
+        // flushed to the OS instead. False if any write, or the close, failed,
+        // so a truncated file can be reported.
+        bool close()
+        {
+            flush();
+            if (owned && out && std::fclose(out) != 0) failed = true;
+            if (!owned && out && std::fflush(out) != 0) failed = true;
+            if (owned) out = nullptr;
+            return !failed;
+        }
+
+        [[nodiscard]] bool ok() const
+        {
+            return out != nullptr;
+        }
+
+        void put(char const* data, std::size_t size)
+        {
+            if (used + size > sizeof(buffer))
+            {
+                flush();
+                if (size > sizeof(buffer))
+                {
+                    if (out && std::fwrite(data, 1, size, out) != size) failed = true;
+                    return;
+                }
+            }
+            for (std::size_t i{ 0 }; i < size; ++i)
+                buffer[used + i] = data[i];
+            used += size;
+        }
+
+        void put(std::string_view sv)
+        {
+            put(sv.data(), sv.size());
+        }
+
+        void put(char c)
+        {
+            if (used == sizeof(buffer)) flush();
+            buffer[used++] = c;
+        }
+
+        void put(std::uint64_t value)
+        {
+            char digits[20];
+            auto const [end, ec]{ std::to_chars(digits, digits + sizeof(digits), value) };
+            put(digits, static_cast<std::size_t>(end - digits));
+        }
+
+        void flush()
+        {
+            if (out && used && std::fwrite(buffer, 1, used, out) != used) failed = true;
+            used = 0;
+        }
+    };
+
+    // Binary token dump, laid out for mmap: header, then count 32-bit value offsets,
+    // count 32-bit lengths and count 1-byte TokenType values, all in the native
+    // byte order of the machine that wrote it.
+    struct TokenDumpHeader
+    {
+        char magic[4]{ 'P', 'T', 'O', 'K' };
+        std::uint32_t version{ 1 };
+        std::uint64_t count{ 0 };
+        std::uint64_t sourceSize{ 0 };
+        std::uint64_t offsetsAt{ 0 };
+        std::uint64_t lengthsAt{ 0 };
+        std::uint64_t typesAt{ 0 };
+    };
+
+    void writeTokenText(TokenBuffer const& tokens, LineTable const& lines, BufferedWriter& out);
+    bool writeTokenBinary(TokenBuffer const& tokens, std::size_t sourceSize, char const* path);
+    void tokenDumpPath(char* out, std::size_t outSize, char const* sourcePath, char const* suffix);
+}
+
+#endif
@@ -0,0 +1,682 @@
+#include "pancemit.hpp"
+#include "pancdef.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace panc
+{
+    namespace
+    {
+        constexpr std::string_view PRELUDE
+        {
+            "#include <inttypes.h>\n"
+            "#include <stdint.h>\n"
+            "#include <stdio.h>\n"
+            "#include <string.h>\n"
+            "\n"
+            "static char panc_out[1 << 16];\n"
+            "static size_t panc_out_used;\n"
+            "static int32_t panc_values[PANC_VALUE_STACK_SIZE];\n"
+            "static uint32_t panc_value_count;\n"
+            "static int panc_depth;\n"
+            "\n"
+            "static void panc_flush(void)\n"
+            "{\n"
+            "    fwrite(panc_out, 1, panc_out_used, stdout);\n"
+            "    fflush(stdout);\n"
+            "    panc_out_used = 0;\n"
+            "}\n"
+            "\n"
+            "static void panc_print(const char* s, size_t n)\n"
+            "{\n"
+            "    if (panc_out_used + n > sizeof panc_out)\n"
+            "    {\n"
+            "        panc_flush();\n"
+            "        if (n > sizeof panc_out) { fwrite(s, 1, n, stdout); return; }\n"
+            "    }\n"
+            "    memcpy(panc_out + panc_out_used, s, n);\n"
+            "    panc_out_used += n;\n"
+            "}\n"
+            "\n"
+            "static inline void panc_print_int(int32_t v)\n"
+            "{\n"
+            "    char digits[16];\n"
+            "    panc_print(digits, (size_t)snprintf(digits, sizeof digits, \"%\" PRId32, v));\n"
+            "}\n"
+            "\n"
+            "static int panc_fail(const char* message)\n"
+            "{\n"
+            "    panc_flush();\n"
+            "    fprintf(stderr, \"Runtime Error: %s\\n\", message);\n"
+            "    return 1;\n"
+            "}\n"
+            "\n"
+            "static inline int panc_too_deep(const char* name)\n"
+            "{\n"
+            "    panc_flush();\n"
+            "    fprintf(stderr, \"Runtime Error: call depth exceeded in %s\\n\", name);\n"
+            "    return 1;\n"
+            "}\n"
+            "\n"
+            "static inline int panc_push(int32_t v)\n"
+            "{\n"
+            "    if (panc_value_count == PANC_VALUE_STACK_SIZE) return panc_fail(\"stack overflow\");\n"
+            "    panc_values[panc_value_count++] = v;\n"
+            "    return 0;\n"
+            "}\n"
+            "\n"
+            "static inline int panc_pop(int32_t* v)\n"
+            "{\n"
+            "    if (panc_value_count == 0) return panc_fail(\"stack underflow\");\n"
+            "    *v = panc_values[--panc_value_count];\n"
+            "    return 0;\n"
+            "}\n"
+            "\n"
+            "static inline int panc_destroy(void)\n"
+            "{\n"
+            "    if (panc_value_count == 0) return panc_fail(\"stack underflow\");\n"
+            "    panc_values[--panc_value_count] = 0;\n"
+            "    return 0;\n"
+            "}\n"
+            "\n"
+            "static inline int32_t panc_add(int32_t a, int32_t b) { return (int32_t)((uint32_t)a + (uint32_t)b); }\n"
+            "static inline int32_t panc_sub(int32_t a, int32_t b) { return (int32_t)((uint32_t)a - (uint32_t)b); }\n"
+            "static inline int32_t panc_mul(int32_t a, int32_t b) { return (int32_t)((uint32_t)a * (uint32_t)b); }\n"
+            "static inline int32_t panc_neg(int32_t a) { return (int32_t)(0u - (uint32_t)a); }\n"
+            "static inline int32_t panc_div(int32_t a, int32_t b) { return b == -1 ? panc_neg(a) : a / b; }\n"
+        };
+
+        // One forth cell: an element of a variable of the class numbered owner.
+        struct CellRef
+        {
+            std::size_t owner;
+            ClassVar const* var;
+            uint32_t element;
+        };
+
+        constexpr std::string_view BINARY_HELPERS[]{ "panc_add", "panc_sub", "panc_mul", "panc_div" };
+        constexpr std::string_view COMPARISONS[]{ " == ", " < ", " > " };
+
+        // An expression result: a literal, a variable read, or a numbered temporary.
+        // Expressions cannot assign, so variables can be read in place.
+        struct Operand
+        {
+            enum class Kind : uint8_t { LITERAL, VARIABLE, TEMP } kind;
+            int32_t value;
+        };
+
+        struct Emitter : ExprVisitor<Emitter, Operand, Expr const>
+        {
+            Program const& program;
+            ForthProgram const& forth;
+            StringTable const& strings;
+            BufferedWriter& out;
+            uint32_t const printLine{ strings.find("print_line") };
+            std::vector<Procedure const*> procedures{};
+            std::vector<bool> declared{};
+            int32_t temps{ 0 };
+            int indent{ 1 };
+
+            Emitter(Program const& source, ForthProgram const& blocks, StringTable const& names, BufferedWriter& writer)
+                : program(source), forth(blocks), strings(names), out(writer), declared(names.size(), false)
+            {
+                for (Procedure const* p{ program.procedures }; p; p = p->next)
+                    procedures.push_back(p);
+            }
+
+            void number(int64_t v)
+            {
+                char digits[24];
+                auto const [end, ec]{ std::to_chars(digits, digits + sizeof(digits), v) };
+                out.put(digits, static_cast<std::size_t>(end - digits));
+            }
+
+            // INT32_MIN has no literal form in C.
+            void literal(int32_t v)
+            {
+                if (v == INT32_MIN) out.put("INT32_MIN");
+                else number(v);
+            }
+
+            void line()
+            {
+                for (int i{ 0 }; i < indent; ++i) out.put("    ");
+            }
+
+            void quoted(std::string_view text)
+            {
+                out.put('"');
+                for (char const c : text)
+                {
+                    unsigned char const u{ static_cast<unsigned char>(c) };
+                    if (c == '"' || c == '\\' || c == '?')
+                    {
+                        out.put('\\');
+                        out.put(c);
+                    }
+                    else if (u < 0x20 || u >= 0x7F)
+                    {
+                        char const octal[]{ '\\', static_cast<char>('0' + (u >> 6)), static_cast<char>('0' + ((u >> 3) & 7)), static_cast<char>('0' + (u & 7)) };
+                        out.put(octal, sizeof(octal));
+                    }
+                    else
+                        out.put(c);
+                }
+                out.put('"');
+            }
+
+            void variable(uint32_t name)
+            {
+                out.put("v_");
+                out.put(strings.get(name));
+            }
+
+            void procedureName(std::size_t index)
+            {
+                out.put('p');
+                number(static_cast<int64_t>(index));
+                out.put('_');
+                out.put(strings.get(procedures[index]->name_idx));
+            }
+
+            void operand(Operand o)
+            {
+                switch (o.kind)
+                {
+                case Operand::Kind::LITERAL: literal(o.value); break;
+                case Operand::Kind::VARIABLE: variable(static_cast<uint32_t>(o.value)); break;
+                case Operand::Kind::TEMP: out.put('t'); number(o.value); break;
+                }
+            }
+
+            Operand temp()
+            {
+                Operand const t{ Operand::Kind::TEMP, temps++ };
+                line();
+                out.put("int32_t ");
+                operand(t);
+                return t;
+            }
+
+            Operand visitLiteral(Expr const* e) { return { Operand::Kind::LITERAL, e->getLiteralValue() }; }
+            Operand visitString(Expr const*) { return { Operand::Kind::LITERAL, 0 }; }
+            Operand visitFuncCall(Expr const*) { return { Operand::Kind::LITERAL, 0 }; }
+            Operand visitVariable(Expr const* e) { return { Operand::Kind::VARIABLE, static_cast<int32_t>(e->getVariableNameIdx()) }; }
+
+            Operand visitUnary(Expr const* e)
+            {
+                Operand const v{ visit(e->getOperand()) };
+                Operand const t{ temp() };
+                out.put(" = panc_neg(");
+                operand(v);
+                out.put(");\n");
+                return t;
+            }
+
+            Operand visitBinary(Expr const* e)
+            {
+                Operand const lhs{ visit(e->getLhs()) };
+                Operand const rhs{ visit(e->getRhs()) };
+                BinaryOp const op{ e->getBinaryOp() };
+                if (op == BinaryOp::DIV && (rhs.kind != Operand::Kind::LITERAL || rhs.value == 0))
+                {
+                    line();
+                    out.put("if (");
+                    operand(rhs);
+                    out.put(" == 0) return panc_fail(\"division by zero\");\n");
+                }
+                Operand const t{ temp() };
+                out.put(" = ");
+                if (op == BinaryOp::EQ || op == BinaryOp::LT || op == BinaryOp::GT)
+                {
+                    operand(lhs);
+                    out.put(COMPARISONS[static_cast<std::size_t>(op) - static_cast<std::size_t>(BinaryOp::EQ)]);
+                    operand(rhs);
+                }
+                else
+                {
+                    out.put(BINARY_HELPERS[static_cast<std::size_t>(op)]);
+                    out.put('(');
+                    operand(lhs);
+                    out.put(", ");
+                    operand(rhs);
+                    out.put(')');
+                }
+                out.put(";\n");
+                return t;
+            }
+
+            Operand visitPop(Expr const*)
+            {
+                Operand const t{ temp() };
+                out.put(";\n");
+                line();
+                out.put("if (panc_pop(&");
+                operand(t);
+                out.put(")) return 1;\n");
+                return t;
+            }
+
+            void call(Expr const& e)
+            {
+                if (e.getFuncId() == printLine)
+                {
+                    for (uint32_t i{ 0 }; i < e.getArgCount(); ++i)
+                    {
+                        Expr const* const arg{ e.getArg(i) };
+                        if (arg->isString())
+                        {
+                            std::string_view const text{ strings.get(arg->getStringIdx()) };
+                            line();
+                            out.put("panc_print(");
+                            quoted(text);
+                            out.put(", ");
+                            number(static_cast<int64_t>(text.size()));
+                            out.put(");\n");
+                            continue;
+                        }
+                        Operand const v{ visit(arg) };
+                        line();
+                        out.put("panc_print_int(");
+                        operand(v);
+                        out.put(");\n");
+                    }
+                    line();
+                    out.put("panc_print(\"\\n\", 1);\n");
+                    return;
+                }
+
+                std::size_t target{ 0 };
+                while (procedures[target]->name_idx != e.getFuncId()) ++target;
+                std::vector<Operand> args{};
+                for (uint32_t i{ 0 }; i < e.getArgCount(); ++i)
+                    args.push_back(visit(e.getArg(i)));
+                line();
+                out.put("if (");
+                procedureName(target);
+                out.put('(');
+                for (std::size_t i{ 0 }; i < args.size(); ++i)
+                {
+                    if (i) out.put(", ");
+                    operand(args[i]);
+                }
+                out.put(")) return 1;\n");
+            }
+
+            void assign(uint32_t name, Operand value)
+            {
+                line();
+                variable(name);
+                out.put(" = ");
+                operand(value);
+                out.put(";\n");
+            }
+
+            void statements(Stmt const* body)
+            {
+                for (Stmt const* s{ body }; s; s = s->next)
+                    switch (s->kind)
+                    {
+                    case StmtKind::CALL:
+                        call(*s->call.expr);
+                        break;
+                    case StmtKind::ASSIGN:
+                        assign(s->assign.target->getVariableNameIdx(), visit(s->assign.value));
+                        break;
+                    case StmtKind::PUSH:
+                    {
+                        Operand const v{ visit(s->push.value) };
+                        line();
+                        out.put("if (panc_push(");
+                        operand(v);
+                        out.put(")) return 1;\n");
+                        break;
+                    }
+                    case StmtKind::DESTROY:
+                        line();
+                        out.put("if (panc_destroy()) return 1;\n");
+                        break;
+                    case StmtKind::FOR:
+                    {
+                        assign(s->loop.var_idx, visit(s->loop.first));
+                        Operand const last{ visit(s->loop.last) };
+                        Operand const limit{ temp() };
+                        out.put(" = ");
+                        operand(last);
+                        out.put(";\n");
+                        line();
+                        out.put("if (");
+                        variable(s->loop.var_idx);
+                        out.put(" <= ");
+                        operand(limit);
+                        out.put(") for (;;)\n");
+                        line();
+                        out.put("{\n");
+                        ++indent;
+                        statements(s->loop.body);
+                        line();
+                        out.put("if (");
+                        variable(s->loop.var_idx);
+                        out.put(" == ");
+                        operand(limit);
+                        out.put(") break;\n");
+                        line();
+                        variable(s->loop.var_idx);
+                        out.put(" = panc_add(");
+                        variable(s->loop.var_idx);
+                        out.put(", 1);\n");
+                        --indent;
+                        line();
+                        out.put("}\n");
+                        break;
+                    }
+                    }
+            }
+
+            // Every declared or assigned name that is not a parameter becomes a zeroed local.
+            void declareLocals(Stmt const* body)
+            {
+                for (Stmt const* s{ body }; s; s = s->next)
+                {
+                    uint32_t const name{ s->kind == StmtKind::ASSIGN ? s->assign.target->getVariableNameIdx()
+                        : s->kind == StmtKind::FOR ? s->loop.var_idx : StringTable::NONE };
+                    if (name != StringTable::NONE && !declared[name])
+                    {
+                        declared[name] = true;
+                        out.put("    int32_t ");
+                        variable(name);
+                        out.put(" = 0;\n");
+                    }
+                    if (s->kind == StmtKind::FOR) declareLocals(s->loop.body);
+                }
+            }
+
+            void signature(std::size_t index)
+            {
+                Procedure const& p{ *procedures[index] };
+                out.put("static int ");
+                procedureName(index);
+                out.put('(');
+                if (!p.params) out.put("void");
+                for (Param const* param{ p.params }; param; param = param->next)
+                {
+                    out.put("int32_t ");
+                    variable(param->name_idx);
+                    if (param->next) out.put(", ");
+                }
+                out.put(')');
+            }
+
+            void procedure(std::size_t index)
+            {
+                Procedure const& p{ *procedures[index] };
+                signature(index);
+                out.put("\n{\n");
+                std::fill(declared.begin(), declared.end(), false);
+                for (Param const* param{ p.params }; param; param = param->next)
+                    declared[param->name_idx] = true;
+                for (Param const* local{ p.locals }; local; local = local->next)
+                    if (!declared[local->name_idx])
+                    {
+                        declared[local->name_idx] = true;
+                        out.put("    int32_t ");
+                        variable(local->name_idx);
+                        out.put(" = 0;\n");
+                    }
+                declareLocals(p.body);
+                temps = 0;
+                indent = 1;
+                out.put("    if (++panc_depth > ");
+                number(static_cast<int64_t>(MAX_STACK_DEPTH));
+                out.put(") return panc_too_deep(");
+                quoted(strings.get(p.name_idx));
+                out.put(");\n");
+                statements(p.body);
+                out.put("    --panc_depth;\n    return 0;\n}\n\n");
+            }
+
+            void cell(std::vector<CellRef> const& cells, int32_t address)
+            {
+                CellRef const& ref{ cells[static_cast<std::size_t>(address)] };
+                out.put('c');
+                number(static_cast<int64_t>(ref.owner));
+                out.put(".v_");
+                out.put(strings.get(ref.var->name_idx));
+                if (ref.var->cells > 1)
+                {
+                    out.put('[');
+                    number(ref.element);
+                    out.put(']');
+                }
+            }
+
+            void forthBlocks()
+            {
+                std::vector<CellRef> cells{};
+                std::size_t index{ 0 };
+                for (Class const* cls{ program.classes }; cls; cls = cls->next, ++index)
+                {
+                    if (!cls->vars) continue;
+                    out.put("/* class ");
+                    out.put(strings.get(cls->name_idx));
+                    out.put(" */\nstatic struct\n{\n");
+                    for (ClassVar const* v{ cls->vars }; v; v = v->next)
+                    {
+                        out.put("    int32_t v_");
+                        out.put(strings.get(v->name_idx));
+                        if (v->cells > 1)
+                        {
+                            out.put('[');
+                            number(v->cells);
+                            out.put(']');
+                        }
+                        out.put(";\n");
+                        for (uint32_t element{ 0 }; element < v->cells; ++element)
+                            cells.push_back({ index, v, element });
+                    }
+                    out.put("} c");
+                    number(static_cast<int64_t>(index));
+                    out.put(";\n\n");
+                }
+
+                bool computed{ false };
+                for (ForthInstr const& instr : forth.code)
+                    computed = computed || instr.op == ForthOp::FETCH || instr.op == ForthOp::STORE;
+                if (computed)
+                {
+                    out.put("static int32_t* panc_cell(int32_t address)\n{\n    switch (address)\n    {\n");
+                    for (std::size_t i{ 0 }; i < cells.size(); ++i)
+                    {
+                        out.put("    case ");
+                        number(static_cast<int64_t>(i));
+                        out.put(": return &");
+                        cell(cells, static_cast<int32_t>(i));
+                        out.put(";\n");
+                    }
+                    out.put("    default: return 0;\n    }\n}\n\n");
+                }
+
+                // Class variable and structure field initialisers, one loop per fill.
+                if (!forth.fills.empty())
+                {
+                    out.put("static void panc_init(void)\n{\n    int32_t i;\n");
+                    for (ForthFill const& fill : forth.fills)
+                    {
+                        out.put("    ");
+                        if (fill.count == 1) cell(cells, static_cast<int32_t>(fill.first));
+                        else
+                        {
+                            CellRef const& ref{ cells[fill.first] };
+                            out.put("for (i = 0; i < ");
+                            number(fill.count);
+                            out.put("; ++i) c");
+                            number(static_cast<int64_t>(ref.owner));
+                            out.put(".v_");
+                            out.put(strings.get(ref.var->name_idx));
+                            out.put('[');
+                            number(ref.element);
+                            out.put(" + i");
+                            if (fill.stride != 1)
+                            {
+                                out.put(" * ");
+                                number(fill.stride);
+                            }
+                            out.put(']');
+                        }
+                        out.put(" = ");
+                        literal(fill.value);
+                        out.put(";\n");
+                    }
+                    out.put("    (void)i;\n}\n\n");
+                }
+
+                for (std::size_t block{ 0 }; block < forth.entries.size(); ++block)
+                {
+                    out.put("static int panc_forth");
+                    number(static_cast<int64_t>(block));
+                    out.put("(void)\n{\n    int32_t s[");
+                    number(static_cast<int64_t>(FORTH_STACK_SIZE));
+                    out.put("];\n    int32_t* sp = s;\n");
+                    for (ForthInstr const* w{ forth.code.data() + forth.entries[block] }; w->op != ForthOp::EXIT; ++w)
+                    {
+                        out.put("    ");
+                        forthWord(cells, *w);
+                        out.put('\n');
+                    }
+                    out.put("    (void)sp;\n    return 0;\n}\n\n");
+                }
+            }
+
+            void forthWord(std::vector<CellRef> const& cells, ForthInstr const& w)
+            {
+                static constexpr std::string_view fetchCell{ "{ int32_t* c = panc_cell(sp[-1]); if (!c) return panc_fail(\"invalid address in forth block\"); " };
+                switch (w.op)
+                {
+                case ForthOp::LIT:
+                case ForthOp::ADDR: out.put("*sp++ = "); literal(w.arg); out.put(';'); break;
+                case ForthOp::FETCH: out.put(fetchCell); out.put("sp[-1] = *c; }"); break;
+                case ForthOp::STORE: out.put(fetchCell); out.put("*c = sp[-2]; sp -= 2; }"); break;
+                case ForthOp::ADD: out.put("sp[-2] = panc_add(sp[-2], sp[-1]); --sp;"); break;
+                case ForthOp::SUB: out.put("sp[-2] = panc_sub(sp[-2], sp[-1]); --sp;"); break;
+                case ForthOp::MUL: out.put("sp[-2] = panc_mul(sp[-2], sp[-1]); --sp;"); break;
+                case ForthOp::DIV: out.put("{ if (sp[-1] == 0) return panc_fail(\"division by zero\"); sp[-2] = panc_div(sp[-2], sp[-1]); --sp; }"); break;
+                case ForthOp::EQ: out.put("sp[-2] = sp[-2] == sp[-1] ? -1 : 0; --sp;"); break;
+                case ForthOp::LT: out.put("sp[-2] = sp[-2] < sp[-1] ? -1 : 0; --sp;"); break;
+                case ForthOp::GT: out.put("sp[-2] = sp[-2] > sp[-1] ? -1 : 0; --sp;"); break;
+                case ForthOp::DUP: out.put("sp[0] = sp[-1]; ++sp;"); break;
+                case ForthOp::DROP: out.put("--sp;"); break;
+                case ForthOp::SWAP: out.put("{ int32_t t = sp[-1]; sp[-1] = sp[-2]; sp[-2] = t; }"); break;
+                case ForthOp::OVER: out.put("sp[0] = sp[-2]; ++sp;"); break;
+                case ForthOp::PRINT: out.put("panc_print_int(*--sp); panc_print(\" \", 1);"); break;
+                case ForthOp::EXIT: break;
+                case ForthOp::FETCH_VAR: out.put("*sp++ = "); cell(cells, w.arg); out.put(';'); break;
+                case ForthOp::STORE_VAR: cell(cells, w.arg); out.put(" = *--sp;"); break;
+                case ForthOp::ADD_LIT: out.put("sp[-1] = panc_add(sp[-1], "); literal(w.arg); out.put(");"); break;
+                case ForthOp::SUB_LIT: out.put("sp[-1] = panc_sub(sp[-1], "); literal(w.arg); out.put(");"); break;
+                case ForthOp::MUL_LIT: out.put("sp[-1] = panc_mul(sp[-1], "); literal(w.arg); out.put(");"); break;
+                }
+            }
+
+            void emit()
+            {
+                out.put("/* Generated by pancakesC --emit-c. */\n#define PANC_VALUE_STACK_SIZE ");
+                number(static_cast<int64_t>(VALUE_STACK_SIZE));
+                out.put('\n');
+                out.put(PRELUDE);
+                out.put('\n');
+                forthBlocks();
+
+                std::size_t mainIndex{ 0 };
+                for (std::size_t i{ 0 }; i < procedures.size(); ++i)
+                {
+                    if (procedures[i] == program.main) mainIndex = i;
+                    signature(i);
+                    out.put(";\n");
+                }
+                out.put('\n');
+                for (std::size_t i{ 0 }; i < procedures.size(); ++i)
+                    procedure(i);
+
+                out.put("int main(void)\n{\n    int failed = 0;\n");
+                if (!forth.fills.empty()) out.put("    panc_init();\n");
+                for (std::size_t block{ 0 }; block < forth.entries.size(); ++block)
+                {
+                    out.put("    if (!failed) failed = panc_forth");
+                    number(static_cast<int64_t>(block));
+                    out.put("();\n");
+                }
+                if (!forth.entries.empty()) out.put("    panc_print(\"\\n\", 1);\n");
+                out.put("    if (!failed) failed = ");
+                procedureName(mainIndex);
+                out.put("();\n    panc_flush();\n    return failed || ferror(stdout);\n}\n");
+            }
+        };
+    }
+
+    namespace
+    {
+        // Once compile() has passed, a call inside an expression is new or a cell read.
+        bool callsIn(Expr const* e)
+        {
+            switch (e->kind)
+            {
+            case ExprKind::FUNC_CALL: return true;
+            case ExprKind::BINARY: return callsIn(e->getLhs()) || callsIn(e->getRhs());
+            case ExprKind::UNARY: return callsIn(e->getOperand());
+            default: return false;
+            }
+        }
+
+        bool usesHeap(Stmt const* body, uint32_t deleteName, uint32_t pinName)
+        {
+            for (Stmt const* s{ body }; s; s = s->next)
+                switch (s->kind)
+                {
+                case StmtKind::CALL:
+                {
+                    Expr const& call{ *s->call.expr };
+                    if (call.getFuncId() == deleteName || call.getFuncId() == pinName) return true;
+                    for (uint32_t i{ 0 }; i < call.getArgCount(); ++i)
+                        if (callsIn(call.getArg(i))) return true;
+                    break;
+                }
+                case StmtKind::ASSIGN:
+                    if (s->assign.target->isFuncCall() || callsIn(s->assign.value)) return true;
+                    break;
+                case StmtKind::PUSH:
+                    if (callsIn(s->push.value)) return true;
+                    break;
+                case StmtKind::FOR:
+                    if (callsIn(s->loop.first) || callsIn(s->loop.last) || usesHeap(s->loop.body, deleteName, pinName)) return true;
+                    break;
+                case StmtKind::DESTROY:
+                    break;
+                }
+            return false;
+        }
+    }
+
+    bool canEmitC(Program const& program, StringTable const& strings)
+    {
+        uint32_t const deleteName{ strings.find("delete") };
+        uint32_t const pinName{ strings.find("pin") };
+        for (Procedure const* p{ program.procedures }; p; p = p->next)
+            if (usesHeap(p->body, deleteName, pinName))
+            {
+                std::cerr << "Compile Error: new, delete, pin and cell indexing cannot be emitted as C, in procedure "
+                    << strings.get(p->name_idx) << '\n';
+                return false;
+            }
+        return true;
+    }
+
+    void emitC(Program const& program, ForthProgram const& forth, StringTable const& strings, BufferedWriter& out)
+    {
+        Emitter{ program, forth, strings, out }.emit();
+    }
+}
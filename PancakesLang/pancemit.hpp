@@ -0,0 +1,30 @@
+#ifndef PANCEMIT_HPP
+#define PANCEMIT_HPP
+
+#include "pancast.hpp"
+#include "pancdump.hpp"
+#include "pancexpr.hpp"
+#include "pancforth.hpp"
+
+namespace panc
+{
+    // Writes program as one self-contained C99 translation unit. The program must
+    // already have passed compile() and compileForth(), because names, arity and
+    // stack effects are not re-checked here.
+    //
+    // Procedures become C functions that return nonzero on a runtime error.
+    // Class variables become fields of one static struct per class. Forth blocks
+    // become functions that main() runs first, as the interpreters do. Output
+    // goes through a buffered writer in the generated runtime that is flushed
+    // to the OS before any error message, and main() fails if writing it did.
+    // Integer arithmetic wraps exactly as it does in the VM. Each operator gets
+    // its own temporary, emitted by recursing as deep as the tallest expression
+    // tree, which the parser keeps within MAX_STACK_DEPTH.
+    void emitC(Program const& program, ForthProgram const& forth, StringTable const& strings, BufferedWriter& out);
+
+    // The generated runtime has no heap: reports a program that uses new,
+    // delete, pin or cell indexing instead of emitting it.
+    bool canEmitC(Program const& program, StringTable const& strings);
+}
+
+#endif
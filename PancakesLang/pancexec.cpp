@@ -0,0 +1,308 @@
+#include "pancexec.hpp"
+#include "pancdef.hpp"
+#include "pancpool.hpp"
+#include "pancstack.hpp"
+#include <climits>
+#include <iostream>
+#include <vector>
+
+namespace panc
+{
+    namespace
+    {
+        struct Binding
+        {
+            uint32_t name;
+            int32_t value;
+        };
+
+        // Grows with the procedure, so the walker binds as many locals as the compiled engines do.
+        using Frame = std::vector<Binding>;
+
+        struct Interpreter
+        {
+            Program const& program;
+            StringTable const& strings;
+            uint32_t const printLine{ strings.find("print_line") };
+            uint32_t const integerType{ strings.find("integer") };
+            uint32_t const newName{ strings.find("new") };
+            uint32_t const deleteName{ strings.find("delete") };
+            uint32_t const pinName{ strings.find("pin") };
+            std::size_t depth{ 0 };
+            ValueStacks stacks{};
+            Heap heap{};
+
+            static bool check(char const* error)
+            {
+                if (!error) return true;
+                std::cerr << "Runtime Error: " << error << '\n';
+                return false;
+            }
+
+            Procedure const* find(uint32_t name_idx) const
+            {
+                for (Procedure const* p{ program.procedures }; p; p = p->next)
+                    if (p->name_idx == name_idx)
+                        return p;
+                return nullptr;
+            }
+
+            static Binding* lookup(Frame& frame, uint32_t name)
+            {
+                for (std::size_t i{ 0 }; i < frame.size(); ++i)
+                    if (frame[i].name == name)
+                        return &frame[i];
+                return nullptr;
+            }
+
+            static void bind(Frame& frame, uint32_t name, int32_t value)
+            {
+                if (Binding* const b{ lookup(frame, name) })
+                    b->value = value;
+                else
+                    frame.push_back({ name, value });
+            }
+
+            bool run(Procedure const& proc, Frame& frame)
+            {
+                if (++depth > MAX_STACK_DEPTH)
+                {
+                    std::cerr << "Runtime Error: call depth exceeded in " << strings.get(proc.name_idx) << '\n';
+                    return false;
+                }
+                for (Param const* local{ proc.locals }; local; local = local->next)
+                    bind(frame, local->name_idx, 0);
+                for (Stmt const* s{ proc.body }; s; s = s->next)
+                    if (!step(*s, frame))
+                        return false;
+                --depth;
+                return true;
+            }
+
+            bool step(Stmt const& s, Frame& frame)
+            {
+                switch (s.kind)
+                {
+                case StmtKind::CALL:
+                    return call(*s.call.expr, frame);
+                case StmtKind::ASSIGN:
+                {
+                    Expr const& target{ *s.assign.target };
+                    int32_t value{};
+                    if (target.isVariable())
+                    {
+                        if (!eval(*s.assign.value, frame, value)) return false;
+                        bind(frame, target.getVariableNameIdx(), value);
+                        return true;
+                    }
+                    // H(i) <- value
+                    Binding const* const handle{ lookup(frame, target.getFuncId()) };
+                    if (!handle || target.getArgCount() != 1)
+                    {
+                        std::cerr << "Runtime Error: cannot assign to " << strings.get(target.getFuncId()) << '\n';
+                        return false;
+                    }
+                    int32_t index{};
+                    return eval(*target.getArg(0), frame, index) && eval(*s.assign.value, frame, value)
+                        && check(heap.store(handle->value, index, value));
+                }
+                case StmtKind::PUSH:
+                {
+                    int32_t value{};
+                    if (!eval(*s.push.value, frame, value)) return false;
+                    if (!stacks.integers.push(value))
+                    {
+                        std::cerr << "Runtime Error: stack overflow\n";
+                        return false;
+                    }
+                    return true;
+                }
+                case StmtKind::DESTROY:
+                    if (s.destroy.type_idx != integerType)
+                    {
+                        std::cerr << "Runtime Error: only integer values can be destroyed\n";
+                        return false;
+                    }
+                    if (!stacks.integers.destroy())
+                    {
+                        std::cerr << "Runtime Error: stack underflow\n";
+                        return false;
+                    }
+                    return true;
+                case StmtKind::FOR:
+                {
+                    int32_t first{}, last{};
+                    if (!eval(*s.loop.first, frame, first) || !eval(*s.loop.last, frame, last)) return false;
+                    if (first > last)
+                    {
+                        bind(frame, s.loop.var_idx, first);
+                        return true;
+                    }
+                    // The variable itself is the counter, and the loop ends once it reaches
+                    // last rather than once it passes it, so last may be INT32_MAX.
+                    for (int32_t i{ first }; ; i = static_cast<int32_t>(static_cast<uint32_t>(i) + 1))
+                    {
+                        bind(frame, s.loop.var_idx, i);
+                        for (Stmt const* inner{ s.loop.body }; inner; inner = inner->next)
+                            if (!step(*inner, frame))
+                                return false;
+                        i = lookup(frame, s.loop.var_idx)->value;
+                        if (i == last) return true;
+                    }
+                }
+                }
+                return false;
+            }
+
+            bool call(Expr const& expr, Frame& frame)
+            {
+                if (expr.getFuncId() == printLine)
+                {
+                    for (uint32_t i{ 0 }; i < expr.getArgCount(); ++i)
+                    {
+                        Expr const* const arg{ expr.getArg(i) };
+                        int32_t value{};
+                        if (arg->isString()) std::cout << strings.get(arg->getStringIdx());
+                        else if (eval(*arg, frame, value)) std::cout << value;
+                        else return false;
+                    }
+                    std::cout << '\n';
+                    return true;
+                }
+                if (expr.getFuncId() == deleteName || expr.getFuncId() == pinName)
+                {
+                    int32_t handle{};
+                    if (!eval(*expr.getArg(0), frame, handle)) return false;
+                    return check(expr.getFuncId() == deleteName ? heap.release(handle) : heap.pin(handle));
+                }
+
+                Procedure const* const target{ find(expr.getFuncId()) };
+                if (!target)
+                {
+                    std::cerr << "Runtime Error: unknown procedure " << strings.get(expr.getFuncId()) << '\n';
+                    return false;
+                }
+                if (expr.getArgCount() != target->param_count)
+                {
+                    std::cerr << "Runtime Error: " << strings.get(expr.getFuncId()) << " expects " << target->param_count
+                        << " argument(s), got " << expr.getArgCount() << '\n';
+                    return false;
+                }
+
+                Frame callee{};
+                Param const* param{ target->params };
+                for (uint32_t i{ 0 }; i < expr.getArgCount(); ++i, param = param->next)
+                {
+                    int32_t value{};
+                    if (!eval(*expr.getArg(i), frame, value)) return false;
+                    bind(callee, param->name_idx, value);
+                }
+                return run(*target, callee);
+            }
+
+            // Integers wrap on overflow, like the unsigned arithmetic they are computed in.
+            bool eval(Expr const& expr, Frame& frame, int32_t& out)
+            {
+                switch (expr.kind)
+                {
+                case ExprKind::LITERAL:
+                    out = expr.getLiteralValue();
+                    return true;
+                case ExprKind::STRING:
+                    std::cerr << "Runtime Error: string used as a number\n";
+                    return false;
+                case ExprKind::VARIABLE:
+                {
+                    if (Binding const* const b{ lookup(frame, expr.getVariableNameIdx()) })
+                    {
+                        out = b->value;
+                        return true;
+                    }
+                    std::cerr << "Runtime Error: undefined variable " << strings.get(expr.getVariableNameIdx()) << '\n';
+                    return false;
+                }
+                case ExprKind::FUNC_CALL:
+                {
+                    if (expr.getFuncId() == newName)
+                    {
+                        int32_t first{}, last{};
+                        return eval(*expr.getArg(0), frame, first) && eval(*expr.getArg(1), frame, last)
+                            && check(heap.create(first, last, out));
+                    }
+                    // H(i) reads cell i of the block handle H holds.
+                    Binding const* const handle{ lookup(frame, expr.getFuncId()) };
+                    if (!handle || expr.getArgCount() != 1)
+                    {
+                        std::cerr << "Runtime Error: " << strings.get(expr.getFuncId()) << " does not produce a value\n";
+                        return false;
+                    }
+                    int32_t index{};
+                    return eval(*expr.getArg(0), frame, index) && check(heap.load(handle->value, index, out));
+                }
+                case ExprKind::UNARY:
+                {
+                    int32_t v{};
+                    if (!eval(*expr.getOperand(), frame, v)) return false;
+                    out = static_cast<int32_t>(0u - static_cast<uint32_t>(v));
+                    return true;
+                }
+                case ExprKind::BINARY:
+                {
+                    int32_t l{}, r{};
+                    if (!eval(*expr.getLhs(), frame, l) || !eval(*expr.getRhs(), frame, r)) return false;
+                    return arithmetic(expr.getBinaryOp(), l, r, out);
+                }
+                case ExprKind::POP:
+                    if (expr.getPopTypeIdx() != integerType)
+                    {
+                        std::cerr << "Runtime Error: only integer values can be popped\n";
+                        return false;
+                    }
+                    if (!stacks.integers.pop(out))
+                    {
+                        std::cerr << "Runtime Error: stack underflow\n";
+                        return false;
+                    }
+                    return true;
+                }
+                return false;
+            }
+
+            static bool arithmetic(BinaryOp op, int32_t l, int32_t r, int32_t& out)
+            {
+                uint32_t const a{ static_cast<uint32_t>(l) };
+                uint32_t const b{ static_cast<uint32_t>(r) };
+                switch (op)
+                {
+                case BinaryOp::ADD: out = static_cast<int32_t>(a + b); return true;
+                case BinaryOp::SUB: out = static_cast<int32_t>(a - b); return true;
+                case BinaryOp::MUL: out = static_cast<int32_t>(a * b); return true;
+                case BinaryOp::DIV:
+                    if (r == 0)
+                    {
+                        std::cerr << "Runtime Error: division by zero\n";
+                        return false;
+                    }
+                    out = (l == INT32_MIN && r == -1) ? INT32_MIN : l / r;
+                    return true;
+                case BinaryOp::EQ: out = l == r; return true;
+                case BinaryOp::LT: out = l < r; return true;
+                case BinaryOp::GT: out = l > r; return true;
+                }
+                return false;
+            }
+        };
+    }
+
+    bool execute(Program const& program, StringTable const& strings)
+    {
+        if (!program.main)
+        {
+            std::cerr << "Runtime Error: main procedure not found\n";
+            return false;
+        }
+        Interpreter interpreter{ program, strings };
+        Frame frame{};
+        return interpreter.run(*program.main, frame);
+    }
+}
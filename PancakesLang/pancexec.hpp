@@ -0,0 +1,13 @@
+#ifndef PANCEXEC_HPP
+#define PANCEXEC_HPP
+
+#include "pancast.hpp"
+#include "pancexpr.hpp"
+
+namespace panc
+{
+    // Runs the program's main procedure by walking the syntax tree.
+    bool execute(Program const& program, StringTable const& strings);
+}
+
+#endif
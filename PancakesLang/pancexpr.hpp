@@ -1,12 +1,15 @@
 #ifndef PANCEXPR_HPP
 #define PANCEXPR_HPP
 
+#include "pancarena.hpp"
 #include "pancarray.hpp"
 #include "pancstring.hpp"
 #include "pancdef.hpp"
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <new>
+#include <vector>
 
 namespace panc
 {
@@ -16,13 +19,39 @@ namespace panc
     enum class ExprKind : uint8_t
     {
         LITERAL,
+        STRING,
         VARIABLE,
-        FUNC_CALL
+        FUNC_CALL,
+        BINARY,
+        UNARY,
+        POP
     };
 
+    enum class BinaryOp : uint8_t
+    {
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        EQ,
+        LT,
+        GT
+    };
+
+    enum class UnaryOp : uint8_t
+    {
+        NEG
+    };
+
+    // A 24-byte header on 64-bit targets. A FUNC_CALL node is followed directly by
+    // its arg_count argument pointers, so allocate it with funcCallSize().
+    // height counts the nodes on the longest path down to a leaf; the parser keeps
+    // it within MAX_STACK_DEPTH, so passes may recurse over a tree.
     struct Expr
     {
         ExprKind kind;
+        uint8_t op;
+        uint16_t height;
 
         union
         {
@@ -31,6 +60,11 @@ namespace panc
                 int32_t value;
             } literal;
 
+            struct
+            {
+                uint32_t str_idx;
+            } text;
+
             struct
             {
                 uint32_t name_idx;
@@ -40,39 +74,105 @@ namespace panc
             {
                 uint32_t func_id;
                 uint32_t arg_count;
-                Expr* args[panc::MAX_FUNC_ARGS];
             } func_call;
+
+            struct
+            {
+                Expr* lhs;
+                Expr* rhs;
+            } binary;
+
+            struct
+            {
+                Expr* operand;
+            } unary;
+
+            struct
+            {
+                uint32_t type_idx;
+            } pop;
         };
 
+        static constexpr std::size_t funcCallSize(uint32_t arg_count)
+        {
+            return sizeof(Expr) + arg_count * sizeof(Expr*);
+        }
+
         static Expr* createLiteral(int32_t value, void* memory)
         {
-            Expr* expr{ new (memory) Expr };
+            Expr* expr{ new (memory) Expr{} };
             expr->kind = ExprKind::LITERAL;
             expr->literal.value = value;
+            expr->height = 1;
+            return expr;
+        }
+
+        static Expr* createString(uint32_t str_idx, void* memory)
+        {
+            Expr* expr{ new (memory) Expr{} };
+            expr->kind = ExprKind::STRING;
+            expr->text.str_idx = str_idx;
+            expr->height = 1;
             return expr;
         }
 
         static Expr* createVariable(uint32_t name_idx, void* memory)
         {
-            Expr* expr{ new (memory) Expr };
+            Expr* expr{ new (memory) Expr{} };
             expr->kind = ExprKind::VARIABLE;
             expr->variable.name_idx = name_idx;
+            expr->height = 1;
             return expr;
         }
 
-        static Expr* createFuncCall(uint32_t func_id, Expr** args, uint32_t arg_count, void* memory)
+        // memory must hold funcCallSize(arg_count) bytes.
+        static Expr* createFuncCall(uint32_t func_id, Expr* const* args, uint32_t arg_count, void* memory)
         {
-            Expr* expr{ new (memory) Expr };
+            Expr* expr{ new (memory) Expr{} };
             expr->kind = ExprKind::FUNC_CALL;
             expr->func_call.func_id = func_id;
             expr->func_call.arg_count = arg_count;
+            expr->height = 1;
+
+            for (uint32_t i{ 0 }; i < arg_count; ++i)
+                expr->height = above(expr->height - 1, args[i]);
 
-            for (uint32_t i{}; i < arg_count && i < panc::MAX_FUNC_ARGS; ++i)
-                expr->func_call.args[i] = args[i];
+            if (arg_count)
+                std::memcpy(expr->argSpan(), args, arg_count * sizeof(Expr*));
 
             return expr;
         }
 
+        static Expr* createBinary(BinaryOp op, Expr* lhs, Expr* rhs, void* memory)
+        {
+            Expr* expr{ new (memory) Expr{} };
+            expr->kind = ExprKind::BINARY;
+            expr->op = static_cast<uint8_t>(op);
+            expr->binary.lhs = lhs;
+            expr->binary.rhs = rhs;
+            expr->height = above(lhs->height, rhs);
+            return expr;
+        }
+
+        static Expr* createUnary(UnaryOp op, Expr* operand, void* memory)
+        {
+            Expr* expr{ new (memory) Expr{} };
+            expr->kind = ExprKind::UNARY;
+            expr->op = static_cast<uint8_t>(op);
+            expr->unary.operand = operand;
+            expr->height = above(0, operand);
+            return expr;
+        }
+
+        static Expr* createPop(uint32_t type_idx, void* memory)
+        {
+            Expr* expr{ new (memory) Expr{} };
+            expr->kind = ExprKind::POP;
+            expr->pop.type_idx = type_idx;
+            expr->height = 1;
+            return expr;
+        }
+
         void accept(IRVisitor& visitor);
 
         bool isLiteral() const
@@ -80,6 +180,11 @@ namespace panc
             return kind == ExprKind::LITERAL;
         }
 
+        bool isString() const
+        {
+            return kind == ExprKind::STRING;
+        }
+
         bool isVariable() const
         {
             return kind == ExprKind::VARIABLE;
@@ -90,11 +195,31 @@ namespace panc
             return kind == ExprKind::FUNC_CALL;
         }
 
+        bool isBinary() const
+        {
+            return kind == ExprKind::BINARY;
+        }
+
+        bool isUnary() const
+        {
+            return kind == ExprKind::UNARY;
+        }
+
+        bool isPop() const
+        {
+            return kind == ExprKind::POP;
+        }
+
         int32_t getLiteralValue() const
         {
             return literal.value;
         }
 
+        uint32_t getStringIdx() const
+        {
+            return text.str_idx;
+        }
+
         uint32_t getVariableNameIdx() const
         {
             return variable.name_idx;
@@ -112,46 +237,215 @@ namespace panc
 
         Expr* getArg(uint32_t index) const
         {
-            return func_call.args[index];
+            return argSpan()[index];
+        }
+
+        Expr* const* getArgs() const
+        {
+            return argSpan();
+        }
+
+        void setArg(uint32_t index, Expr* arg)
+        {
+            argSpan()[index] = arg;
+        }
+
+        BinaryOp getBinaryOp() const
+        {
+            return static_cast<BinaryOp>(op);
+        }
+
+        Expr* getLhs() const
+        {
+            return binary.lhs;
+        }
+
+        Expr* getRhs() const
+        {
+            return binary.rhs;
+        }
+
+        UnaryOp getUnaryOp() const
+        {
+            return static_cast<UnaryOp>(op);
+        }
+
+        Expr* getOperand() const
+        {
+            return unary.operand;
+        }
+
+        uint32_t getPopTypeIdx() const
+        {
+            return pop.type_idx;
+        }
+
+    private:
+        // The height of a node over a child and a sibling subtree of the given height.
+        static uint16_t above(unsigned sibling, Expr const* child)
+        {
+            unsigned const tallest{ child->height > sibling ? child->height : sibling };
+            return static_cast<uint16_t>(tallest < UINT16_MAX ? tallest + 1 : UINT16_MAX);
+        }
+
+        Expr** argSpan() const
+        {
+            return reinterpret_cast<Expr**>(const_cast<Expr*>(this) + 1);
         }
     };
 
-    struct StringTable
+    static_assert(alignof(Expr) >= alignof(Expr*) && sizeof(Expr) % alignof(Expr*) == 0,
+        "call arguments must start aligned right after the node header");
+
+    // Interns names and string literals: equal text always maps to the same id,
+    // so downstream passes compare ids instead of characters. Ids are dense,
+    // starting at 0. Text lives in chunks carved from the arena and stays valid
+    // for the arena's lifetime; add() returns NONE once the arena is exhausted.
+    class StringTable
     {
-        panc::array<char, 4096> buffer{};
-        uint32_t offset{};
+    public:
+        static constexpr uint32_t NONE{ UINT32_MAX };
+
+    private:
+        static constexpr std::size_t FIRST_CHUNK{ 256 };
+        static constexpr std::size_t MAX_CHUNK{ 4096 };
+
+        struct Entry
+        {
+            char const* text;
+            uint32_t length;
+            uint32_t hash;
+        };
+
+        Arena& arena;
+        char* chunk{ nullptr };
+        std::size_t chunkLeft{ 0 };
+        std::size_t nextChunk{ FIRST_CHUNK };
+        std::vector<Entry> entries{};
+        std::vector<uint32_t> slots{};
+
+    public:
+        explicit StringTable(Arena& memory) : arena(memory) {}
+        StringTable(StringTable const&) = delete;
+        StringTable& operator=(StringTable const&) = delete;
 
         uint32_t add(char const* str)
         {
-            uint32_t start{ offset };
-            uint32_t len{};
+            return add(str, static_cast<uint32_t>(std::strlen(str)));
+        }
 
-            while (str[len] && (offset + len + 1) < buffer.size())
-            {
-                buffer[offset + len] = str[len];
-                ++len;
-            }
+        uint32_t add(char const* str, uint32_t size)
+        {
+            if ((entries.size() + 1) * 2 > slots.size())
+                rehash(slots.empty() ? 64 : slots.size() * 2);
+
+            uint32_t const h{ hash(str, size) };
+            std::size_t const mask{ slots.size() - 1 };
+            std::size_t i{ h & mask };
+            for (; slots[i]; i = (i + 1) & mask)
+                if (matches(entries[slots[i] - 1], str, size, h))
+                    return slots[i] - 1;
+
+            char* const text{ store(str, size) };
+            if (!text || entries.size() >= NONE - 1)
+                return NONE;
+            entries.push_back({ text, size, h });
+            slots[i] = static_cast<uint32_t>(entries.size());
+            return slots[i] - 1;
+        }
 
-            if (offset + len < buffer.size())
-            {
-                buffer[offset + len] = '\0';
-                offset += len + 1;
-                return start;
-            }
+        uint32_t find(char const* str) const
+        {
+            return find(str, static_cast<uint32_t>(std::strlen(str)));
+        }
 
-            return 0;
+        uint32_t find(char const* str, uint32_t size) const
+        {
+            if (slots.empty())
+                return NONE;
+            uint32_t const h{ hash(str, size) };
+            std::size_t const mask{ slots.size() - 1 };
+            for (std::size_t i{ h & mask }; slots[i]; i = (i + 1) & mask)
+                if (matches(entries[slots[i] - 1], str, size, h))
+                    return slots[i] - 1;
+            return NONE;
         }
 
         char const* get(uint32_t idx) const
         {
-            if (idx < offset)
-                return &buffer[idx];
+            if (idx < entries.size())
+                return entries[idx].text;
             return nullptr;
         }
 
+        uint32_t length(uint32_t idx) const
+        {
+            return entries[idx].length;
+        }
+
+        uint32_t size() const
+        {
+            return static_cast<uint32_t>(entries.size());
+        }
+
+        // Forgets every id. Chunk memory is only reclaimed when the arena is.
         void clear()
         {
-            offset = 0;
+            entries.clear();
+            slots.clear();
+            chunk = nullptr;
+            chunkLeft = 0;
+        }
+
+    private:
+        static uint32_t hash(char const* str, uint32_t size)
+        {
+            uint32_t h{ 2166136261u };
+            for (uint32_t i{}; i < size; ++i)
+                h = (h ^ static_cast<unsigned char>(str[i])) * 16777619u;
+            return h;
+        }
+
+        static bool matches(Entry const& e, char const* str, uint32_t size, uint32_t h)
+        {
+            return e.hash == h && e.length == size && std::memcmp(e.text, str, size) == 0;
+        }
+
+        char* store(char const* str, uint32_t size)
+        {
+            std::size_t const need{ std::size_t{ size } + 1 };
+            if (need > chunkLeft)
+            {
+                std::size_t const bytes{ need > nextChunk ? need : nextChunk };
+                chunk = static_cast<char*>(arena.allocateBytes(bytes, 1));
+                if (!chunk)
+                {
+                    chunkLeft = 0;
+                    return nullptr;
+                }
+                chunkLeft = bytes;
+                if (nextChunk < MAX_CHUNK)
+                    nextChunk *= 2;
+            }
+            char* const text{ chunk };
+            std::memcpy(text, str, size);
+            text[size] = '\0';
+            chunk += need;
+            chunkLeft -= need;
+            return text;
+        }
+
+        void rehash(std::size_t count)
+        {
+            slots.assign(count, 0);
+            std::size_t const mask{ count - 1 };
+            for (uint32_t id{}; id < entries.size(); ++id)
+            {
+                std::size_t i{ entries[id].hash & mask };
+                while (slots[i])
+                    i = (i + 1) & mask;
+                slots[i] = id + 1;
+            }
         }
     };
 
@@ -160,8 +454,43 @@ namespace panc
         virtual ~IRVisitor() {}
 
         virtual void visitLiteral(Expr* expr) = 0;
+        virtual void visitString(Expr* expr) = 0;
         virtual void visitVariable(Expr* expr) = 0;
         virtual void visitFuncCall(Expr* expr) = 0;
+        virtual void visitBinary(Expr* expr) = 0;
+        virtual void visitUnary(Expr* expr) = 0;
+        virtual void visitPop(Expr* expr) = 0;
+    };
+
+    // Compile-time counterpart of IRVisitor: Derived provides the same visitX
+    // members (any return type convertible to Result) and visit() calls them
+    // directly, so a whole tree walk can be inlined. Use Node = Expr const for
+    // read-only passes.
+    template<typename Derived, typename Result = void, typename Node = Expr>
+    struct ExprVisitor
+    {
+        Result visit(Node* expr)
+        {
+            Derived& self{ static_cast<Derived&>(*this) };
+            switch (expr->kind)
+            {
+            case ExprKind::LITERAL:
+                return self.visitLiteral(expr);
+            case ExprKind::STRING:
+                return self.visitString(expr);
+            case ExprKind::VARIABLE:
+                return self.visitVariable(expr);
+            case ExprKind::FUNC_CALL:
+                return self.visitFuncCall(expr);
+            case ExprKind::BINARY:
+                return self.visitBinary(expr);
+            case ExprKind::UNARY:
+                return self.visitUnary(expr);
+            case ExprKind::POP:
+                return self.visitPop(expr);
+            }
+            return Result();
+        }
     };
 
     inline void Expr::accept(IRVisitor& visitor)
@@ -171,12 +500,24 @@ namespace panc
         case ExprKind::LITERAL:
             visitor.visitLiteral(this);
             break;
+        case ExprKind::STRING:
+            visitor.visitString(this);
+            break;
         case ExprKind::VARIABLE:
             visitor.visitVariable(this);
             break;
         case ExprKind::FUNC_CALL:
             visitor.visitFuncCall(this);
             break;
+        case ExprKind::BINARY:
+            visitor.visitBinary(this);
+            break;
+        case ExprKind::UNARY:
+            visitor.visitUnary(this);
+            break;
+        case ExprKind::POP:
+            visitor.visitPop(this);
+            break;
         }
     }
 }
@@ -0,0 +1,364 @@
+#include "pancforth.hpp"
+#include "pancdef.hpp"
+#include "pancstruct.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+namespace panc
+{
+    namespace
+    {
+        struct Effect
+        {
+            int8_t needs;
+            int8_t delta;
+        };
+
+        // Indexed by ForthOp, up to EXIT.
+        constexpr Effect EFFECTS[]
+        {
+            { 0, 1 }, { 0, 1 }, { 1, 0 }, { 2, -2 },
+            { 2, -1 }, { 2, -1 }, { 2, -1 }, { 2, -1 }, { 2, -1 }, { 2, -1 }, { 2, -1 },
+            { 1, 1 }, { 1, -1 }, { 2, 0 }, { 2, 1 }, { 1, -1 }, { 0, 0 }
+        };
+        static_assert(std::size(EFFECTS) == static_cast<std::size_t>(ForthOp::EXIT) + 1, "one stack effect per plain word");
+
+        ForthOp primitive(ForthWordKind kind)
+        {
+            switch (kind)
+            {
+            case ForthWordKind::ADD: return ForthOp::ADD;
+            case ForthWordKind::SUB: return ForthOp::SUB;
+            case ForthWordKind::MUL: return ForthOp::MUL;
+            case ForthWordKind::DIV: return ForthOp::DIV;
+            case ForthWordKind::EQ: return ForthOp::EQ;
+            case ForthWordKind::LT: return ForthOp::LT;
+            case ForthWordKind::GT: return ForthOp::GT;
+            case ForthWordKind::STORE: return ForthOp::STORE;
+            case ForthWordKind::FETCH: return ForthOp::FETCH;
+            case ForthWordKind::PRINT: return ForthOp::PRINT;
+            case ForthWordKind::LITERAL:
+            case ForthWordKind::NAME:
+                break;
+            }
+            return ForthOp::LIT;
+        }
+
+        // Peephole pass over one block: each fusable pair becomes one instruction.
+        void fuse(std::vector<ForthInstr> const& plain, ForthProgram& out)
+        {
+            for (std::size_t i{ 0 }; i < plain.size(); ++i)
+            {
+                ForthInstr const w{ plain[i] };
+                ForthOp const next{ i + 1 < plain.size() ? plain[i + 1].op : ForthOp::EXIT };
+                ForthOp fused{ w.op };
+                if (w.op == ForthOp::ADDR && next == ForthOp::FETCH) fused = ForthOp::FETCH_VAR;
+                else if (w.op == ForthOp::ADDR && next == ForthOp::STORE) fused = ForthOp::STORE_VAR;
+                else if (w.op == ForthOp::LIT && next == ForthOp::ADD) fused = ForthOp::ADD_LIT;
+                else if (w.op == ForthOp::LIT && next == ForthOp::SUB) fused = ForthOp::SUB_LIT;
+                else if (w.op == ForthOp::LIT && next == ForthOp::MUL) fused = ForthOp::MUL_LIT;
+                out.code.push_back({ fused, w.arg });
+                if (fused != w.op)
+                {
+                    ++i;
+                    ++out.fused;
+                }
+            }
+        }
+
+        // Type names are case-insensitive, like the keywords.
+        bool sameType(char const* type, char const* first, char const* last)
+        {
+            for (; first != last; ++type, ++first)
+                if (!*type || std::tolower(static_cast<unsigned char>(*type)) != std::tolower(static_cast<unsigned char>(*first)))
+                    return false;
+            return !*type;
+        }
+
+        // A "P.x" word for field x of structure array P expands to ( i -- addr ):
+        // i * stride + first, with the multiply left out for unit strides. When
+        // more than one type's group has an x, "P.integer.x" says which is meant
+        // and a bare "P.x" is ambiguous.
+        std::size_t fieldWord(Class const& cls, uint32_t base, uint32_t name, StringTable const& strings, ForthInstr* out, bool& ambiguous)
+        {
+            char const* const text{ strings.get(name) };
+            char const* const dot{ std::strchr(text, '.') };
+            if (!dot) return 0;
+            char const* const qualified{ std::strchr(dot + 1, '.') };
+            uint32_t const varName{ strings.find(text, static_cast<uint32_t>(dot - text)) };
+            uint32_t const fieldName{ strings.find(qualified ? qualified + 1 : dot + 1) };
+            uint32_t cell{ 0 };
+            ClassVar const* v{ cls.vars };
+            for (; v && v->name_idx != varName; v = v->next) cell += v->cells;
+            if (!v || !v->structure) return 0;
+            StructField const* f{ nullptr };
+            for (StructField const* g{ v->structure->fields }; g; g = g->next)
+                if (g->name_idx == fieldName && (!qualified || sameType(strings.get(g->type_idx), dot + 1, qualified)))
+                {
+                    ambiguous = f != nullptr;
+                    if (ambiguous) return 0;
+                    f = g;
+                }
+            if (!f) return 0;
+
+            FieldAccess const access{ fieldAccess(*v, *f) };
+            std::size_t count{ 0 };
+            if (access.stride != 1)
+            {
+                out[count++] = { ForthOp::LIT, static_cast<int32_t>(access.stride) };
+                out[count++] = { ForthOp::MUL, 0 };
+            }
+            out[count++] = { ForthOp::LIT, static_cast<int32_t>(base + cell + access.first) };
+            out[count++] = { ForthOp::ADD, 0 };
+            return count;
+        }
+
+        // One fill per initialised class variable, and per initialised field of
+        // each structure array, two for floats.
+        void addFills(Class const& cls, uint32_t base, ForthProgram& out)
+        {
+            uint32_t cell{ base };
+            for (ClassVar const* v{ cls.vars }; v; cell += v->cells, v = v->next)
+            {
+                if (v->init) out.fills.push_back({ cell, 1, 1, v->init });
+                for (StructField const* f{ v->structure ? v->structure->fields : nullptr }; f; f = f->next)
+                {
+                    if (!f->has_init || f->init == 0) continue;
+                    int32_t words[2]{ static_cast<int32_t>(f->init), 0 };
+                    if (f->size == sizeof(double)) std::memcpy(words, &f->init, sizeof(double));
+                    FieldAccess const access{ fieldAccess(*v, *f) };
+                    for (uint32_t w{ 0 }; w < f->size / CELL_BYTES; ++w)
+                        if (words[w]) out.fills.push_back({ cell + access.first + w, v->count, access.stride, words[w] });
+                }
+            }
+        }
+
+        bool error(char const* what, Class const& cls, StringTable const& strings)
+        {
+            std::cerr << "Compile Error: " << what << " in forth block of class " << strings.get(cls.name_idx) << '\n';
+            return false;
+        }
+    }
+
+    bool compileForth(Program const& program, StringTable const& strings, ForthProgram& out)
+    {
+        out = ForthProgram{};
+        struct Builtin
+        {
+            uint32_t name;
+            ForthOp op;
+        };
+        Builtin const builtins[]
+        {
+            { strings.find("dup"), ForthOp::DUP },
+            { strings.find("drop"), ForthOp::DROP },
+            { strings.find("swap"), ForthOp::SWAP },
+            { strings.find("over"), ForthOp::OVER }
+        };
+
+        std::vector<ForthInstr> plain{};
+        bool ok{ true };
+        for (Class const* cls{ program.classes }; cls; out.cellCount += cls->cell_count, cls = cls->next)
+        {
+            addFills(*cls, out.cellCount, out);
+            for (ForthBlock const* block{ cls->forth }; block; block = block->next)
+            {
+                plain.clear();
+                int depth{ 0 };
+                bool blockOk{ true };
+                for (uint32_t i{ 0 }; i < block->word_count && blockOk; ++i)
+                {
+                    ForthWord const& w{ block->words[i] };
+                    ForthInstr instrs[4]{ { primitive(w.kind), w.value } };
+                    std::size_t count{ 1 };
+                    if (w.kind == ForthWordKind::NAME)
+                    {
+                        uint32_t const name{ static_cast<uint32_t>(w.value) };
+                        bool found{ false };
+                        for (Builtin const& b : builtins)
+                            if (b.name == name)
+                            {
+                                instrs[0] = { b.op, 0 };
+                                found = true;
+                            }
+                        uint32_t cell{ 0 };
+                        for (ClassVar const* v{ cls->vars }; v && !found; cell += v->cells, v = v->next)
+                            if (v->name_idx == name)
+                            {
+                                instrs[0] = { ForthOp::ADDR, static_cast<int32_t>(out.cellCount + cell) };
+                                found = true;
+                            }
+                        bool ambiguous{ false };
+                        if (!found && (count = fieldWord(*cls, out.cellCount, name, strings, instrs, ambiguous)) != 0) found = true;
+                        if (!found)
+                        {
+                            std::cerr << "Compile Error: " << (ambiguous ? "field in more than one group, name its type: " : "unknown word ") << strings.get(name)
+                                << " in forth block of class " << strings.get(cls->name_idx) << '\n';
+                            blockOk = false;
+                            break;
+                        }
+                    }
+                    for (std::size_t k{ 0 }; k < count && blockOk; ++k)
+                    {
+                        Effect const effect{ EFFECTS[static_cast<std::size_t>(instrs[k].op)] };
+                        if (depth < effect.needs) blockOk = error("stack underflow", *cls, strings);
+                        else if ((depth += effect.delta) > static_cast<int>(FORTH_STACK_SIZE)) blockOk = error("stack overflow", *cls, strings);
+                        plain.push_back(instrs[k]);
+                    }
+                }
+                ok = ok && blockOk;
+                if (!blockOk) continue;
+                out.entries.push_back(static_cast<uint32_t>(out.code.size()));
+                fuse(plain, out);
+                out.code.push_back({ ForthOp::EXIT, 0 });
+            }
+        }
+        return ok;
+    }
+
+#if PANC_THREADED_DISPATCH
+#define FORTH_WORD(name) word_##name:
+#define FORTH_DISPATCH() goto *ip->target
+#else
+#define FORTH_WORD(name) case ForthOp::name:
+#define FORTH_DISPATCH() goto dispatch
+#endif
+#define FORTH_NEXT() do { ++ip; FORTH_DISPATCH(); } while (0)
+#define FORTH_BINARY(expr) do { --sp; uint32_t const a{ static_cast<uint32_t>(sp[-1]) }, b{ static_cast<uint32_t>(*sp) }; \
+    (void)a; (void)b; sp[-1] = static_cast<int32_t>(expr); FORTH_NEXT(); } while (0)
+
+    // The compiler has bounded every block's depth, so pushes and pops are
+    // unchecked; only computed addresses and divisors are checked here.
+    bool runForth(ForthProgram const& forth)
+    {
+#if PANC_THREADED_DISPATCH
+        struct Cell
+        {
+            void const* target;
+            int32_t arg;
+        };
+        static void const* const words[]
+        {
+            &&word_LIT, &&word_ADDR, &&word_FETCH, &&word_STORE, &&word_ADD, &&word_SUB, &&word_MUL, &&word_DIV,
+            &&word_EQ, &&word_LT, &&word_GT, &&word_DUP, &&word_DROP, &&word_SWAP, &&word_OVER, &&word_PRINT,
+            &&word_EXIT, &&word_FETCH_VAR, &&word_STORE_VAR, &&word_ADD_LIT, &&word_SUB_LIT, &&word_MUL_LIT
+        };
+        static_assert(std::size(words) == static_cast<std::size_t>(ForthOp::MUL_LIT) + 1, "one handler per word");
+        std::vector<Cell> code(forth.code.size());
+        for (std::size_t i{ 0 }; i < code.size(); ++i)
+            code[i] = { words[static_cast<std::size_t>(forth.code[i].op)], forth.code[i].arg };
+#else
+        using Cell = ForthInstr;
+        std::vector<Cell> const& code{ forth.code };
+#endif
+
+        std::vector<int32_t> cells(forth.cellCount);
+        for (ForthFill const& fill : forth.fills)
+            if (fill.stride == 1) std::fill_n(cells.begin() + fill.first, fill.count, fill.value);
+            else
+                for (uint32_t i{ 0 }, cell{ fill.first }; i < fill.count; ++i, cell += fill.stride)
+                    cells[cell] = fill.value;
+        int32_t stack[FORTH_STACK_SIZE];
+        for (uint32_t const entry : forth.entries)
+        {
+            int32_t* sp{ stack };
+            Cell const* ip{ code.data() + entry };
+#if PANC_THREADED_DISPATCH
+            FORTH_DISPATCH();
+#else
+        dispatch:
+            switch (ip->op)
+            {
+#endif
+            FORTH_WORD(LIT)
+                *sp++ = ip->arg;
+                FORTH_NEXT();
+            FORTH_WORD(ADDR)
+                *sp++ = ip->arg;
+                FORTH_NEXT();
+            FORTH_WORD(FETCH)
+                if (static_cast<uint32_t>(sp[-1]) >= cells.size()) goto badAddress;
+                sp[-1] = cells[static_cast<uint32_t>(sp[-1])];
+                FORTH_NEXT();
+            FORTH_WORD(STORE)
+                if (static_cast<uint32_t>(sp[-1]) >= cells.size()) goto badAddress;
+                cells[static_cast<uint32_t>(sp[-1])] = sp[-2];
+                sp -= 2;
+                FORTH_NEXT();
+            FORTH_WORD(ADD)
+                FORTH_BINARY(a + b);
+            FORTH_WORD(SUB)
+                FORTH_BINARY(a - b);
+            FORTH_WORD(MUL)
+                FORTH_BINARY(a * b);
+            FORTH_WORD(DIV)
+                if (sp[-1] == 0) goto divideByZero;
+                FORTH_BINARY((sp[-1] == INT32_MIN && *sp == -1) ? INT32_MIN : sp[-1] / *sp);
+            FORTH_WORD(EQ)
+                FORTH_BINARY(a == b ? -1 : 0);
+            FORTH_WORD(LT)
+                FORTH_BINARY(sp[-1] < *sp ? -1 : 0);
+            FORTH_WORD(GT)
+                FORTH_BINARY(sp[-1] > *sp ? -1 : 0);
+            FORTH_WORD(DUP)
+                *sp = sp[-1];
+                ++sp;
+                FORTH_NEXT();
+            FORTH_WORD(DROP)
+                --sp;
+                FORTH_NEXT();
+            FORTH_WORD(SWAP)
+            {
+                int32_t const top{ sp[-1] };
+                sp[-1] = sp[-2];
+                sp[-2] = top;
+                FORTH_NEXT();
+            }
+            FORTH_WORD(OVER)
+                *sp = sp[-2];
+                ++sp;
+                FORTH_NEXT();
+            FORTH_WORD(PRINT)
+                std::cout << *--sp << ' ';
+                FORTH_NEXT();
+            FORTH_WORD(EXIT)
+                continue;
+            FORTH_WORD(FETCH_VAR)
+                *sp++ = cells[static_cast<uint32_t>(ip->arg)];
+                FORTH_NEXT();
+            FORTH_WORD(STORE_VAR)
+                cells[static_cast<uint32_t>(ip->arg)] = *--sp;
+                FORTH_NEXT();
+            FORTH_WORD(ADD_LIT)
+                sp[-1] = static_cast<int32_t>(static_cast<uint32_t>(sp[-1]) + static_cast<uint32_t>(ip->arg));
+                FORTH_NEXT();
+            FORTH_WORD(SUB_LIT)
+                sp[-1] = static_cast<int32_t>(static_cast<uint32_t>(sp[-1]) - static_cast<uint32_t>(ip->arg));
+                FORTH_NEXT();
+            FORTH_WORD(MUL_LIT)
+                sp[-1] = static_cast<int32_t>(static_cast<uint32_t>(sp[-1]) * static_cast<uint32_t>(ip->arg));
+                FORTH_NEXT();
+#if !PANC_THREADED_DISPATCH
+            }
+#endif
+        }
+        return true;
+
+    badAddress:
+        std::cerr << "Runtime Error: invalid address in forth block\n";
+        return false;
+    divideByZero:
+        std::cerr << "Runtime Error: division by zero\n";
+        return false;
+    }
+
+#undef FORTH_BINARY
+#undef FORTH_NEXT
+#undef FORTH_DISPATCH
+#undef FORTH_WORD
+}
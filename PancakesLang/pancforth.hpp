@@ -0,0 +1,77 @@
+#ifndef PANCFORTH_HPP
+#define PANCFORTH_HPP
+
+#include "pancast.hpp"
+#include "pancexpr.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace panc
+{
+    enum class ForthOp : uint8_t
+    {
+        LIT,        // push arg
+        ADDR,       // push the address of cell arg
+        FETCH,      // addr -- value
+        STORE,      // value addr --
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        EQ,
+        LT,
+        GT,
+        DUP,
+        DROP,
+        SWAP,
+        OVER,
+        PRINT,      // value --
+        EXIT,
+        // Superinstructions fused from the pair named in the comment.
+        FETCH_VAR,  // ADDR FETCH
+        STORE_VAR,  // ADDR STORE
+        ADD_LIT,    // LIT ADD
+        SUB_LIT,    // LIT SUB
+        MUL_LIT     // LIT MUL
+    };
+
+    struct ForthInstr
+    {
+        ForthOp op;
+        int32_t arg;
+    };
+
+    // Sets count cells, stride apart from first, to value: a class variable's
+    // initialiser, or one structure field's across an array, or half of a float's.
+    struct ForthFill
+    {
+        uint32_t first;
+        uint32_t count;
+        uint32_t stride;
+        int32_t value;
+    };
+
+    // Compiled forth blocks of every class, in source order. Class variables are
+    // laid out back to back in one cell array of cellCount integers; a name in a
+    // block becomes the address of its class's (first) cell, and "P.x" takes an
+    // element index and gives the address of that element's field x.
+    struct ForthProgram
+    {
+        std::vector<ForthInstr> code{};
+        std::vector<uint32_t> entries{};
+        std::vector<ForthFill> fills{};
+        uint32_t cellCount{ 0 };
+        uint32_t fused{ 0 };
+    };
+
+    // Resolves names to dup/drop/swap/over or the enclosing class's variables and
+    // checks each block's stack effect, so underflow and overflow of the fixed
+    // FORTH_STACK_SIZE data stack are compile errors.
+    bool compileForth(Program const& program, StringTable const& strings, ForthProgram& out);
+
+    // Runs every block once, in order, against class cells that are zero apart
+    // from the fills.
+    bool runForth(ForthProgram const& forth);
+}
+
+#endif
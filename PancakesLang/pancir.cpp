@@ -0,0 +1,326 @@
+#include "pancir.hpp"
+#include "pancdump.hpp"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace panc
+{
+    namespace
+    {
+        template<typename T>
+        void putArray(BufferedWriter& out, std::vector<T> const& v)
+        {
+            out.put(reinterpret_cast<char const*>(v.data()), v.size() * sizeof(T));
+        }
+
+        template<typename T>
+        bool takeArray(char const*& p, char const* end, std::vector<T>& v, std::size_t count)
+        {
+            std::size_t const bytes{ count * sizeof(T) };
+            if (static_cast<std::size_t>(end - p) < bytes) return false;
+            v.resize(count);
+            if (bytes) std::memcpy(v.data(), p, bytes);
+            p += bytes;
+            return true;
+        }
+    }
+
+    struct ExprPool::Flattener : ExprVisitor<Flattener, NodeId, Expr const>
+    {
+        ExprPool& pool;
+
+        explicit Flattener(ExprPool& target) : pool(target) {}
+
+        NodeId visitLiteral(Expr const* expr)
+        {
+            return pool.push(expr->kind, 0, static_cast<uint32_t>(expr->getLiteralValue()), 0);
+        }
+
+        NodeId visitString(Expr const* expr)
+        {
+            return pool.push(expr->kind, 0, expr->getStringIdx(), 0);
+        }
+
+        NodeId visitVariable(Expr const* expr)
+        {
+            return pool.push(expr->kind, 0, expr->getVariableNameIdx(), 0);
+        }
+
+        NodeId visitPop(Expr const* expr)
+        {
+            return pool.push(expr->kind, 0, expr->getPopTypeIdx(), 0);
+        }
+
+        NodeId visitUnary(Expr const* expr)
+        {
+            NodeId const operand{ visit(expr->getOperand()) };
+            return pool.push(expr->kind, expr->op, operand, 0);
+        }
+
+        NodeId visitBinary(Expr const* expr)
+        {
+            NodeId const lhs{ visit(expr->getLhs()) };
+            NodeId const rhs{ visit(expr->getRhs()) };
+            return pool.push(expr->kind, expr->op, lhs, rhs);
+        }
+
+        // Arguments are flattened first; their own calls append to args in between,
+        // so this call's id list is written only once all of them exist.
+        NodeId visitFuncCall(Expr const* expr)
+        {
+            uint32_t const count{ expr->getArgCount() };
+            std::vector<NodeId> ids(count);
+            for (uint32_t i{ 0 }; i < count; ++i)
+                ids[i] = visit(expr->getArg(i));
+            uint32_t const at{ static_cast<uint32_t>(pool.args.size()) };
+            pool.args.push_back(count);
+            pool.args.insert(pool.args.end(), ids.begin(), ids.end());
+            return pool.push(expr->kind, 0, expr->getFuncId(), at);
+        }
+    };
+
+    NodeId ExprPool::add(Expr const& root)
+    {
+        NodeId const id{ Flattener{ *this }.visit(&root) };
+        roots.push_back(id);
+        return id;
+    }
+
+    NodeId ExprPool::push(ExprKind kind, uint8_t op, uint32_t first, uint32_t second)
+    {
+        kinds.push_back(static_cast<uint8_t>(kind));
+        ops.push_back(op);
+        firsts.push_back(first);
+        seconds.push_back(second);
+        return static_cast<NodeId>(kinds.size() - 1);
+    }
+
+    // Collects the nodes under id with a worklist rather than recursion, then
+    // builds them in id order, which puts every child before its parent. A node
+    // shared by several parents is built once.
+    Expr* ExprPool::toExpr(NodeId id, Arena& arena) const
+    {
+        std::unordered_map<NodeId, Expr*> built{ { id, nullptr } };
+        std::vector<NodeId> order{ id };
+        auto const reach{ [&](NodeId child)
+        {
+            if (built.emplace(child, nullptr).second) order.push_back(child);
+        } };
+        for (std::size_t i{ 0 }; i < order.size(); ++i)
+        {
+            NodeId const n{ order[i] };
+            switch (kind(n))
+            {
+            case ExprKind::UNARY:
+                reach(operand(n));
+                break;
+            case ExprKind::BINARY:
+                reach(lhs(n));
+                reach(rhs(n));
+                break;
+            case ExprKind::FUNC_CALL:
+                for (uint32_t a{ 0 }; a < argCount(n); ++a)
+                    reach(argIds(n)[a]);
+                break;
+            default:
+                break;
+            }
+        }
+        std::sort(order.begin(), order.end());
+
+        std::vector<Expr*> callArgs{};
+        for (NodeId const n : order)
+        {
+            void* const memory{ arena.allocateBytes(kind(n) == ExprKind::FUNC_CALL
+                ? Expr::funcCallSize(argCount(n)) : sizeof(Expr), alignof(Expr)) };
+            if (!memory) return nullptr;
+            switch (kind(n))
+            {
+            case ExprKind::LITERAL:
+                built[n] = Expr::createLiteral(literal(n), memory);
+                break;
+            case ExprKind::STRING:
+                built[n] = Expr::createString(index(n), memory);
+                break;
+            case ExprKind::VARIABLE:
+                built[n] = Expr::createVariable(index(n), memory);
+                break;
+            case ExprKind::POP:
+                built[n] = Expr::createPop(index(n), memory);
+                break;
+            case ExprKind::UNARY:
+                built[n] = Expr::createUnary(unaryOp(n), built.at(operand(n)), memory);
+                break;
+            case ExprKind::BINARY:
+                built[n] = Expr::createBinary(binaryOp(n), built.at(lhs(n)), built.at(rhs(n)), memory);
+                break;
+            case ExprKind::FUNC_CALL:
+                callArgs.assign(argCount(n), nullptr);
+                for (uint32_t i{ 0 }; i < argCount(n); ++i)
+                    callArgs[i] = built.at(argIds(n)[i]);
+                built[n] = Expr::createFuncCall(index(n), callArgs.data(), argCount(n), memory);
+                break;
+            }
+        }
+        return built.at(id);
+    }
+
+    void ExprPool::clear()
+    {
+        kinds.clear();
+        ops.clear();
+        firsts.clear();
+        seconds.clear();
+        args.clear();
+        roots.clear();
+    }
+
+    void ExprPool::reserve(std::size_t nodes)
+    {
+        kinds.reserve(nodes);
+        ops.reserve(nodes);
+        firsts.reserve(nodes);
+        seconds.reserve(nodes);
+    }
+
+    bool ExprPool::write(char const* path, StringTable const& strings) const
+    {
+        BufferedWriter out{ path };
+        if (!out.ok()) return false;
+        ExprPoolHeader header{};
+        header.nodeCount = static_cast<uint32_t>(kinds.size());
+        header.argCount = static_cast<uint32_t>(args.size());
+        header.rootCount = static_cast<uint32_t>(roots.size());
+        for (uint32_t id{ 0 }; id < strings.size(); ++id)
+            header.stringBytes += strings.length(id) + 1;
+        out.put(reinterpret_cast<char const*>(&header), sizeof(header));
+        putArray(out, firsts);
+        putArray(out, seconds);
+        putArray(out, args);
+        putArray(out, roots);
+        putArray(out, kinds);
+        putArray(out, ops);
+        for (uint32_t id{ 0 }; id < strings.size(); ++id)
+            out.put(strings.get(id), strings.length(id) + 1);
+        return out.close();
+    }
+
+    // Every operand must name an earlier node, every argument list must lie
+    // inside args and every name must be a string read, so toExpr stays in bounds.
+    bool ExprPool::valid(std::size_t stringCount) const
+    {
+        for (NodeId id{ 0 }; id < kinds.size(); ++id)
+        {
+            uint32_t const first{ firsts[id] };
+            uint32_t const second{ seconds[id] };
+            switch (kind(id))
+            {
+            case ExprKind::LITERAL:
+                break;
+            case ExprKind::STRING:
+            case ExprKind::VARIABLE:
+            case ExprKind::POP:
+                if (first >= stringCount) return false;
+                break;
+            case ExprKind::UNARY:
+                if (ops[id] > static_cast<uint8_t>(UnaryOp::NEG) || first >= id) return false;
+                break;
+            case ExprKind::BINARY:
+                if (ops[id] > static_cast<uint8_t>(BinaryOp::GT) || first >= id || second >= id) return false;
+                break;
+            case ExprKind::FUNC_CALL:
+                if (first >= stringCount || second >= args.size() || args[second] > args.size() - second - 1) return false;
+                for (uint32_t i{ 0 }; i < args[second]; ++i)
+                    if (args[second + 1 + i] >= id) return false;
+                break;
+            default:
+                return false;
+            }
+        }
+        for (NodeId const root : roots)
+            if (root >= kinds.size()) return false;
+        return true;
+    }
+
+    bool ExprPool::read(char const* data, std::size_t size, StringTable& strings)
+    {
+        ExprPoolHeader header{};
+        ExprPoolHeader const expected{};
+        if (size < sizeof(header)) return false;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version)
+            return false;
+
+        char const* p{ data + sizeof(header) };
+        char const* const end{ data + size };
+        bool const framed{ takeArray(p, end, firsts, header.nodeCount)
+            && takeArray(p, end, seconds, header.nodeCount)
+            && takeArray(p, end, args, header.argCount)
+            && takeArray(p, end, roots, header.rootCount)
+            && takeArray(p, end, kinds, header.nodeCount)
+            && takeArray(p, end, ops, header.nodeCount)
+            && static_cast<std::size_t>(end - p) >= header.stringBytes };
+        if (!framed)
+        {
+            clear();
+            return false;
+        }
+        // Strings were written in id order and are distinct, so re-interning them
+        // into an empty table hands out the same ids.
+        strings.clear();
+        char const* const stringsEnd{ p + header.stringBytes };
+        for (uint32_t id{ 0 }; p < stringsEnd; ++id)
+        {
+            char const* const nul{ static_cast<char const*>(std::memchr(p, '\0', static_cast<std::size_t>(stringsEnd - p))) };
+            if (!nul || strings.add(p, static_cast<uint32_t>(nul - p)) != id)
+            {
+                clear();
+                strings.clear();
+                return false;
+            }
+            p = nul + 1;
+        }
+        if (!valid(strings.size()))
+        {
+            clear();
+            strings.clear();
+            return false;
+        }
+        return true;
+    }
+
+    namespace
+    {
+        void flattenBody(Stmt const* body, ExprPool& pool)
+        {
+            for (Stmt const* s{ body }; s; s = s->next)
+                switch (s->kind)
+                {
+                case StmtKind::CALL:
+                    pool.add(*s->call.expr);
+                    break;
+                case StmtKind::ASSIGN:
+                    pool.add(*s->assign.target);
+                    pool.add(*s->assign.value);
+                    break;
+                case StmtKind::PUSH:
+                    pool.add(*s->push.value);
+                    break;
+                case StmtKind::FOR:
+                    pool.add(*s->loop.first);
+                    pool.add(*s->loop.last);
+                    flattenBody(s->loop.body, pool);
+                    break;
+                case StmtKind::DESTROY:
+                    break;
+                }
+        }
+    }
+
+    void flattenProgram(Program const& program, ExprPool& pool)
+    {
+        for (Procedure const* proc{ program.procedures }; proc; proc = proc->next)
+            flattenBody(proc->body, pool);
+    }
+}
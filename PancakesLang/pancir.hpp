@@ -0,0 +1,143 @@
+#ifndef PANCIR_HPP
+#define PANCIR_HPP
+
+#include "pancarena.hpp"
+#include "pancast.hpp"
+#include "pancexpr.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace panc
+{
+    using NodeId = uint32_t;
+
+    // Flat expression IR: one slot per node across parallel arrays, children always
+    // stored before their parent, so a forward loop over 0..size() is a postorder
+    // walk. Operands and call arguments are NodeIds, never pointers, which keeps the
+    // whole pool relocatable and writable with a single memcpy per array.
+    //
+    // Per-kind meaning of the two operand slots:
+    //   LITERAL   first = value bits
+    //   STRING    first = string table index
+    //   VARIABLE  first = name index
+    //   FUNC_CALL first = function name index, second = offset into args, where
+    //             args[second] is the count and the argument ids follow it
+    //   BINARY    first = lhs, second = rhs
+    //   UNARY     first = operand
+    //   POP       first = type name index
+    class ExprPool
+    {
+        std::vector<uint8_t> kinds{};
+        std::vector<uint8_t> ops{};
+        std::vector<uint32_t> firsts{};
+        std::vector<uint32_t> seconds{};
+        std::vector<NodeId> args{};
+        std::vector<NodeId> roots{};
+
+    public:
+        NodeId add(Expr const& root);
+        Expr* toExpr(NodeId id, Arena& arena) const;
+
+        void clear();
+        void reserve(std::size_t nodes);
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return kinds.size();
+        }
+
+        [[nodiscard]] std::size_t rootCount() const
+        {
+            return roots.size();
+        }
+
+        [[nodiscard]] NodeId root(std::size_t index) const
+        {
+            return roots[index];
+        }
+
+        [[nodiscard]] ExprKind kind(NodeId id) const
+        {
+            return static_cast<ExprKind>(kinds[id]);
+        }
+
+        [[nodiscard]] BinaryOp binaryOp(NodeId id) const
+        {
+            return static_cast<BinaryOp>(ops[id]);
+        }
+
+        [[nodiscard]] UnaryOp unaryOp(NodeId id) const
+        {
+            return static_cast<UnaryOp>(ops[id]);
+        }
+
+        [[nodiscard]] int32_t literal(NodeId id) const
+        {
+            return static_cast<int32_t>(firsts[id]);
+        }
+
+        [[nodiscard]] uint32_t index(NodeId id) const
+        {
+            return firsts[id];
+        }
+
+        [[nodiscard]] NodeId lhs(NodeId id) const
+        {
+            return firsts[id];
+        }
+
+        [[nodiscard]] NodeId rhs(NodeId id) const
+        {
+            return seconds[id];
+        }
+
+        [[nodiscard]] NodeId operand(NodeId id) const
+        {
+            return firsts[id];
+        }
+
+        [[nodiscard]] uint32_t argCount(NodeId id) const
+        {
+            return args[seconds[id]];
+        }
+
+        [[nodiscard]] NodeId const* argIds(NodeId id) const
+        {
+            return args.data() + seconds[id] + 1;
+        }
+
+        bool operator==(ExprPool const& other) const
+        {
+            return kinds == other.kinds && ops == other.ops && firsts == other.firsts && seconds == other.seconds
+                && args == other.args && roots == other.roots;
+        }
+
+        bool write(char const* path, StringTable const& strings) const;
+        bool read(char const* data, std::size_t size, StringTable& strings);
+
+    private:
+        struct Flattener;
+
+        NodeId push(ExprKind kind, uint8_t op, uint32_t first, uint32_t second);
+        bool valid(std::size_t stringCount) const;
+    };
+
+    // On-disk layout: header, then the 32-bit arrays firsts, seconds, args and
+    // roots, then the byte arrays kinds and ops, then stringBytes of NUL-terminated
+    // strings in id order.
+    struct ExprPoolHeader
+    {
+        char magic[4]{ 'P', 'I', 'R', '0' };
+        uint32_t version{ 1 };
+        uint32_t nodeCount{ 0 };
+        uint32_t argCount{ 0 };
+        uint32_t rootCount{ 0 };
+        uint32_t stringBytes{ 0 };
+    };
+
+    // Adds every expression of the program as a root, in source order.
+    void flattenProgram(Program const& program, ExprPool& pool);
+}
+
+#endif
@@ -0,0 +1,735 @@
+#include "pancjit.hpp"
+#include "pancdef.hpp"
+#include "pancpool.hpp"
+#include "pancstack.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace panc
+{
+    NativeCode::~NativeCode()
+    {
+        release();
+    }
+
+    bool NativeCode::load(std::vector<uint8_t> const& bytes)
+    {
+        release();
+        if (bytes.empty()) return false;
+#ifdef _WIN32
+        void* const p{ VirtualAlloc(nullptr, bytes.size(), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE) };
+        if (!p) return false;
+        std::memcpy(p, bytes.data(), bytes.size());
+        DWORD previous{};
+        if (!VirtualProtect(p, bytes.size(), PAGE_EXECUTE_READ, &previous))
+        {
+            VirtualFree(p, 0, MEM_RELEASE);
+            return false;
+        }
+        FlushInstructionCache(GetCurrentProcess(), p, bytes.size());
+#else
+        void* const p{ mmap(nullptr, bytes.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) };
+        if (p == MAP_FAILED) return false;
+        std::memcpy(p, bytes.data(), bytes.size());
+        if (mprotect(p, bytes.size(), PROT_READ | PROT_EXEC) != 0)
+        {
+            munmap(p, bytes.size());
+            return false;
+        }
+#endif
+        pages = p;
+        size = bytes.size();
+        return true;
+    }
+
+    void NativeCode::release()
+    {
+        if (!pages) return;
+#ifdef _WIN32
+        VirtualFree(pages, 0, MEM_RELEASE);
+#else
+        munmap(pages, size);
+#endif
+        pages = nullptr;
+        size = 0;
+    }
+
+#if PANC_JIT
+    namespace
+    {
+        // State shared by all generated code; r15 points at it throughout.
+        struct Runtime
+        {
+            int32_t depth;
+            int32_t failed;
+            Bytecode const* bytecode;
+            StringTable const* strings;
+            ValueStacks stacks;
+            Heap heap;
+        };
+
+        using Entry = int32_t (*)(int32_t const* args, Runtime* rt);
+        using Helper = int32_t (*)(Runtime* rt, int32_t arg);
+        using OperandHelper = int32_t (*)(Runtime* rt, int32_t a, int32_t b, int32_t c);
+
+        int32_t fail(Runtime* rt, char const* message)
+        {
+            std::cerr << "Runtime Error: " << message << '\n';
+            rt->failed = 1;
+            return 0;
+        }
+
+        // Everything generated code cannot do inline goes through one of these.
+        int32_t pushValue(Runtime* rt, int32_t value)
+        {
+            return rt->stacks.integers.push(value) ? 0 : fail(rt, "stack overflow");
+        }
+
+        int32_t popValue(Runtime* rt, int32_t)
+        {
+            int32_t value{};
+            return rt->stacks.integers.pop(value) ? value : fail(rt, "stack underflow");
+        }
+
+        int32_t destroyValue(Runtime* rt, int32_t)
+        {
+            return rt->stacks.integers.destroy() ? 0 : fail(rt, "stack underflow");
+        }
+
+        int32_t heapResult(Runtime* rt, char const* error, int32_t value)
+        {
+            return error ? fail(rt, error) : value;
+        }
+
+        int32_t newCells(Runtime* rt, int32_t first, int32_t last, int32_t)
+        {
+            int32_t handle{};
+            char const* const error{ rt->heap.create(first, last, handle) };
+            return heapResult(rt, error, handle);
+        }
+
+        int32_t loadCell(Runtime* rt, int32_t handle, int32_t index, int32_t)
+        {
+            int32_t value{};
+            char const* const error{ rt->heap.load(handle, index, value) };
+            return heapResult(rt, error, value);
+        }
+
+        int32_t storeCell(Runtime* rt, int32_t handle, int32_t index, int32_t value)
+        {
+            return heapResult(rt, rt->heap.store(handle, index, value), 0);
+        }
+
+        int32_t deleteCells(Runtime* rt, int32_t handle, int32_t, int32_t)
+        {
+            return heapResult(rt, rt->heap.release(handle), 0);
+        }
+
+        int32_t pinCells(Runtime* rt, int32_t handle, int32_t, int32_t)
+        {
+            return heapResult(rt, rt->heap.pin(handle), 0);
+        }
+
+        int32_t printString(Runtime* rt, int32_t id)
+        {
+            std::cout << rt->strings->get(static_cast<uint32_t>(id));
+            return 0;
+        }
+
+        int32_t printInt(Runtime*, int32_t value)
+        {
+            std::cout << value;
+            return 0;
+        }
+
+        int32_t printEnd(Runtime*, int32_t)
+        {
+            std::cout << '\n';
+            return 0;
+        }
+
+        int32_t divideByZero(Runtime* rt, int32_t)
+        {
+            return fail(rt, "division by zero");
+        }
+
+        int32_t depthExceeded(Runtime* rt, int32_t function)
+        {
+            std::cerr << "Runtime Error: call depth exceeded in "
+                << rt->strings->get(rt->bytecode->functions[static_cast<std::size_t>(function)].name) << '\n';
+            rt->failed = 1;
+            return 0;
+        }
+
+        enum Reg : uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+        enum Cond : uint8_t { CC_E = 0x4, CC_NE = 0x5, CC_A = 0x7, CC_L = 0xC, CC_G = 0xF };
+
+#ifdef _WIN32
+        constexpr Reg ARG0{ RCX };
+        constexpr Reg ARG1{ RDX };
+        constexpr Reg ARG2{ R8 };
+        constexpr Reg ARG3{ R9 };
+        constexpr int32_t SHADOW_SPACE{ 32 };
+#else
+        constexpr Reg ARG0{ RDI };
+        constexpr Reg ARG1{ RSI };
+        constexpr Reg ARG2{ RDX };
+        constexpr Reg ARG3{ RCX };
+        constexpr int32_t SHADOW_SPACE{ 0 };
+#endif
+        // Callee-saved, so locals survive calls; the stack registers are
+        // caller-saved and spilled to their frame homes around every call.
+        constexpr Reg LOCAL_REGS[]{ RBX, R12, R13, R14 };
+        constexpr Reg STACK_REGS[]{ R8, R9, R10, R11 };
+        constexpr Reg RUNTIME{ R15 };
+        constexpr int32_t SAVED_BYTES{ 40 };   // rbx and r12-r15, pushed below rbp
+
+        // A 32-bit operand: a register, or memory at [base + disp]. Bases are
+        // never rsp or r12, so no SIB byte is needed.
+        struct Loc
+        {
+            int8_t reg;
+            Reg base;
+            int32_t disp;
+
+            bool isReg() const { return reg >= 0; }
+            bool operator==(Loc const& o) const { return isReg() ? reg == o.reg : (!o.isReg() && base == o.base && disp == o.disp); }
+        };
+
+        constexpr Loc inReg(Reg r) { return { static_cast<int8_t>(r), RBP, 0 }; }
+        constexpr Loc at(Reg base, int32_t disp) { return { -1, base, disp }; }
+
+        struct Assembler
+        {
+            std::vector<uint8_t>& out;
+
+            std::size_t pos() const { return out.size(); }
+            void byte(uint8_t b) { out.push_back(b); }
+            void dword(uint32_t v) { for (int i{ 0 }; i < 4; ++i) byte(static_cast<uint8_t>(v >> (8 * i))); }
+            void qword(uint64_t v) { for (int i{ 0 }; i < 8; ++i) byte(static_cast<uint8_t>(v >> (8 * i))); }
+
+            // [REX] opcode ModRM [disp32]: the ModRM reg field is reg (a register or
+            // an opcode extension) and its r/m operand is loc.
+            void op(std::initializer_list<uint8_t> opcode, unsigned reg, Loc loc, bool wide = false)
+            {
+                unsigned const rm{ loc.isReg() ? static_cast<unsigned>(loc.reg) : static_cast<unsigned>(loc.base) };
+                uint8_t const rex{ static_cast<uint8_t>(0x40 | (wide ? 8 : 0) | ((reg & 8) >> 1) | ((rm & 8) >> 3)) };
+                if (rex != 0x40) byte(rex);
+                for (uint8_t b : opcode) byte(b);
+                if (loc.isReg())
+                    byte(static_cast<uint8_t>(0xC0 | (reg & 7) << 3 | (rm & 7)));
+                else
+                {
+                    byte(static_cast<uint8_t>(0x80 | (reg & 7) << 3 | (rm & 7)));
+                    dword(static_cast<uint32_t>(loc.disp));
+                }
+            }
+
+            void load(Reg r, Loc src) { if (!(src == inReg(r))) op({ 0x8B }, r, src); }
+            void store(Loc dst, Reg r) { if (!(dst == inReg(r))) op({ 0x89 }, r, dst); }
+
+            void move(Loc dst, Loc src)
+            {
+                if (dst == src) return;
+                if (dst.isReg()) load(static_cast<Reg>(dst.reg), src);
+                else if (src.isReg()) store(dst, static_cast<Reg>(src.reg));
+                else
+                {
+                    load(RAX, src);
+                    store(dst, RAX);
+                }
+            }
+
+            void moveImm(Loc dst, int32_t value)
+            {
+                if (dst.isReg())
+                {
+                    if (dst.reg & 8) byte(0x41);
+                    byte(static_cast<uint8_t>(0xB8 + (dst.reg & 7)));
+                }
+                else
+                    op({ 0xC7 }, 0, dst);
+                dword(static_cast<uint32_t>(value));
+            }
+
+            void moveWide(Reg dst, Reg src) { op({ 0x89 }, src, inReg(dst), true); }
+            void test(Reg r) { op({ 0x85 }, r, inReg(r)); }
+            void push(Reg r) { if (r & 8) byte(0x41); byte(static_cast<uint8_t>(0x50 + (r & 7))); }
+            void pop(Reg r) { if (r & 8) byte(0x41); byte(static_cast<uint8_t>(0x58 + (r & 7))); }
+
+            void callAbsolute(void const* target)
+            {
+                byte(0x48);
+                byte(0xB8);
+                qword(reinterpret_cast<uint64_t>(target));
+                byte(0xFF);
+                byte(0xD0);
+            }
+
+            // Branches return the position of their rel32 for patch().
+            std::size_t jump() { byte(0xE9); dword(0); return pos() - 4; }
+            std::size_t jump(Cond cc) { byte(0x0F); byte(static_cast<uint8_t>(0x80 | cc)); dword(0); return pos() - 4; }
+            std::size_t call() { byte(0xE8); dword(0); return pos() - 4; }
+
+            void patch(std::size_t at, std::size_t target)
+            {
+                uint32_t const rel{ static_cast<uint32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(at + 4)) };
+                std::memcpy(out.data() + at, &rel, sizeof(rel));
+            }
+        };
+
+        struct Fixup
+        {
+            std::size_t at;
+            uint32_t target;
+        };
+
+        class Translator
+        {
+            Bytecode const& bytecode;
+            Assembler as;
+            std::vector<std::size_t> pcOffset{};
+            std::vector<int32_t> depthAt{};
+            std::vector<bool> isTarget{};
+            std::vector<Fixup> jumps{};
+            std::vector<Fixup> calls{};
+
+            // Frame of the function being translated.
+            uint32_t index{ 0 };
+            uint32_t end{ 0 };
+            uint32_t locals{ 0 };
+            int32_t areaBase{ 0 };
+            std::vector<std::size_t> toFail{};
+            std::vector<std::size_t> toExit{};
+            std::vector<std::size_t> toDivideByZero{};
+
+        public:
+            Translator(Bytecode const& source, std::vector<uint8_t>& bytes)
+                : bytecode(source), as{ bytes }, pcOffset(source.code.size() + 1, 0),
+                depthAt(source.code.size() + 1, -1), isTarget(source.code.size() + 1, false) {}
+
+            bool translate(std::vector<uint32_t>& entries)
+            {
+                std::vector<uint32_t> order(bytecode.functions.size());
+                for (uint32_t i{ 0 }; i < order.size(); ++i) order[i] = i;
+                std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return bytecode.functions[a].entry < bytecode.functions[b].entry; });
+
+                entries.assign(bytecode.functions.size(), 0);
+                for (std::size_t i{ 0 }; i < order.size(); ++i)
+                {
+                    uint32_t const functionEnd{ i + 1 < order.size() ? bytecode.functions[order[i + 1]].entry : static_cast<uint32_t>(bytecode.code.size()) };
+                    entries[order[i]] = static_cast<uint32_t>(as.pos());
+                    if (!function(order[i], functionEnd)) return false;
+                }
+                for (Fixup const& f : jumps) as.patch(f.at, pcOffset[f.target]);
+                for (Fixup const& f : calls) as.patch(f.at, entries[f.target]);
+                return true;
+            }
+
+        private:
+            Loc local(uint32_t i) const
+            {
+                return i < std::size(LOCAL_REGS) ? inReg(LOCAL_REGS[i]) : at(RBP, areaBase + 4 * static_cast<int32_t>(i - std::size(LOCAL_REGS)));
+            }
+
+            Loc home(int32_t d) const
+            {
+                uint32_t const memoryLocals{ locals > std::size(LOCAL_REGS) ? locals - static_cast<uint32_t>(std::size(LOCAL_REGS)) : 0 };
+                return at(RBP, areaBase + 4 * (static_cast<int32_t>(memoryLocals) + d));
+            }
+
+            Loc slot(int32_t d) const
+            {
+                return d < static_cast<int32_t>(std::size(STACK_REGS)) ? inReg(STACK_REGS[d]) : home(d);
+            }
+
+            int32_t effect(Instr const& instr) const
+            {
+                switch (instr.op)
+                {
+                case Op::CONST: case Op::LOAD: case Op::POP: return 1;
+                case Op::STORE: case Op::ADD: case Op::SUB: case Op::MUL: case Op::DIV: case Op::EQ: case Op::LT: case Op::GT:
+                case Op::PUSH: case Op::PRINT_INT: case Op::JUMP_IF:
+                case Op::NEW: case Op::CELL_LOAD: case Op::DELETE: case Op::PIN: return -1;
+                case Op::CELL_STORE: return -3;
+                case Op::CALL: return -static_cast<int32_t>(bytecode.functions[static_cast<std::size_t>(instr.arg)].params);
+                default: return 0;
+                }
+            }
+
+            // Resolves the operand stack depth before every instruction of [begin, last)
+            // and checks that each jump agrees with the depth at its target.
+            bool depths(uint32_t begin, uint32_t last, uint32_t maxStack)
+            {
+                int32_t d{ 0 };
+                for (uint32_t pc{ begin }; pc < last; ++pc)
+                {
+                    depthAt[pc] = d;
+                    d += effect(bytecode.code[pc]);
+                    if (d < 0 || d > static_cast<int32_t>(maxStack)) return false;
+                    Op const op{ bytecode.code[pc].op };
+                    if (op == Op::JUMP || op == Op::JUMP_IF)
+                    {
+                        uint32_t const target{ static_cast<uint32_t>(bytecode.code[pc].arg) };
+                        if (target < begin || target >= last) return false;
+                        isTarget[target] = true;
+                    }
+                }
+                for (uint32_t pc{ begin }; pc < last; ++pc)
+                {
+                    Op const op{ bytecode.code[pc].op };
+                    if ((op == Op::JUMP || op == Op::JUMP_IF) && depthAt[static_cast<std::size_t>(bytecode.code[pc].arg)] != depthAt[pc] + effect(bytecode.code[pc]))
+                        return false;
+                }
+                return true;
+            }
+
+            void spill(int32_t live)
+            {
+                for (int32_t d{ 0 }; d < live && d < static_cast<int32_t>(std::size(STACK_REGS)); ++d)
+                    as.store(home(d), STACK_REGS[d]);
+            }
+
+            void reload(int32_t live)
+            {
+                for (int32_t d{ 0 }; d < live && d < static_cast<int32_t>(std::size(STACK_REGS)); ++d)
+                    as.load(STACK_REGS[d], home(d));
+            }
+
+            // Calls helper(rt, arg) with the stack slots below live preserved; arg
+            // is value when given, otherwise imm. The result is left in eax.
+            void callHelper(Helper helper, Loc const* value, int32_t imm, int32_t live)
+            {
+                if (value) as.load(ARG1, *value);
+                else as.moveImm(inReg(ARG1), imm);
+                spill(live);
+                as.moveWide(ARG0, RUNTIME);
+                as.callAbsolute(reinterpret_cast<void const*>(helper));
+                reload(live);
+            }
+
+            // Calls helper(rt, a, b, c) on the count operands from depth first up,
+            // which it consumes, with the slots below first preserved. Arguments
+            // are read from the frame homes, so loading one cannot clobber another.
+            void callOperands(OperandHelper helper, int32_t first, int32_t count)
+            {
+                Reg const args[]{ ARG1, ARG2, ARG3 };
+                spill(first + count);
+                for (int32_t i{ 0 }; i < static_cast<int32_t>(std::size(args)); ++i)
+                {
+                    if (i < count) as.load(args[i], home(first + i));
+                    else as.moveImm(inReg(args[i]), 0);
+                }
+                as.moveWide(ARG0, RUNTIME);
+                as.callAbsolute(reinterpret_cast<void const*>(helper));
+                reload(first);
+                checkFailed();
+            }
+
+            void checkFailed()
+            {
+                as.op({ 0x83 }, 7, at(RUNTIME, static_cast<int32_t>(offsetof(Runtime, failed))));
+                as.byte(0);
+                toFail.push_back(as.jump(CC_NE));
+            }
+
+            // lhs holds the left operand, and the right one is either rhs or imm.
+            void arithmetic(Op op, Loc lhs, Loc const* rhs, int32_t imm)
+            {
+                Reg const acc{ lhs.isReg() ? static_cast<Reg>(lhs.reg) : RAX };
+                if (op == Op::MUL)
+                {
+                    if (rhs) { as.load(acc, lhs); as.op({ 0x0F, 0xAF }, acc, *rhs); }
+                    else { as.op({ 0x69 }, acc, lhs); as.dword(static_cast<uint32_t>(imm)); }
+                    as.store(lhs, acc);
+                    return;
+                }
+                unsigned const ext{ op == Op::ADD ? 0u : op == Op::SUB ? 5u : 7u };
+                if (!rhs)
+                {
+                    as.op({ 0x81 }, ext, lhs);
+                    as.dword(static_cast<uint32_t>(imm));
+                    return;
+                }
+                as.load(acc, lhs);
+                as.op({ static_cast<uint8_t>(ext * 8 + 3) }, acc, *rhs);
+                if (op != Op::EQ && op != Op::LT && op != Op::GT) as.store(lhs, acc);
+            }
+
+            // After a compare: branch directly when a JUMP_IF follows, else materialise 0 or 1.
+            uint32_t condition(Op op, Loc lhs, uint32_t next)
+            {
+                Cond const cc{ op == Op::EQ ? CC_E : op == Op::LT ? CC_L : CC_G };
+                if (next < end && bytecode.code[next].op == Op::JUMP_IF && !isTarget[next])
+                {
+                    jumps.push_back({ as.jump(cc), static_cast<uint32_t>(bytecode.code[next].arg) });
+                    return 1;
+                }
+                as.byte(0x0F);
+                as.byte(static_cast<uint8_t>(0x90 | cc));
+                as.byte(0xC0);
+                as.op({ 0x0F, 0xB6 }, RAX, inReg(RAX));
+                as.store(lhs, RAX);
+                return 0;
+            }
+
+            void divide(Loc lhs, Loc rhs)
+            {
+                as.load(RCX, rhs);
+                as.test(RCX);
+                toDivideByZero.push_back(as.jump(CC_E));
+                as.load(RAX, lhs);
+                // idiv traps on INT32_MIN / -1, and x / -1 is just -x with wrapping.
+                as.op({ 0x83 }, 7, inReg(RCX));
+                as.byte(0xFF);
+                std::size_t const notMinusOne{ as.jump(CC_NE) };
+                as.op({ 0xF7 }, 3, inReg(RAX));
+                std::size_t const done{ as.jump() };
+                as.patch(notMinusOne, as.pos());
+                as.byte(0x99);
+                as.op({ 0xF7 }, 7, inReg(RCX));
+                as.patch(done, as.pos());
+                as.store(lhs, RAX);
+            }
+
+            bool function(uint32_t which, uint32_t last)
+            {
+                Function const& f{ bytecode.functions[which] };
+                if (!depths(f.entry, last, f.maxStack)) return false;
+                index = which;
+                end = last;
+                locals = f.locals;
+                toFail.clear();
+                toExit.clear();
+                toDivideByZero.clear();
+
+                uint32_t const memoryLocals{ locals > std::size(LOCAL_REGS) ? locals - static_cast<uint32_t>(std::size(LOCAL_REGS)) : 0 };
+                int32_t const areaBytes{ 4 * static_cast<int32_t>(memoryLocals + f.maxStack) };
+                areaBase = -SAVED_BYTES - areaBytes;
+                // Entry leaves rsp 8 off a 16-byte boundary and the six pushes restore
+                // that, so an odd multiple of 8 keeps calls made from here aligned.
+                int32_t const frameSize{ (areaBytes + SHADOW_SPACE + 8 + 15) / 16 * 16 + 8 };
+
+                as.push(RBP);
+                as.moveWide(RBP, RSP);
+                as.push(RBX);
+                as.push(R12);
+                as.push(R13);
+                as.push(R14);
+                as.push(R15);
+                as.op({ 0x81 }, 5, inReg(RSP), true);
+                as.dword(static_cast<uint32_t>(frameSize));
+                as.moveWide(RUNTIME, ARG1);
+
+                as.op({ 0xFF }, 0, at(RUNTIME, static_cast<int32_t>(offsetof(Runtime, depth))));
+                as.op({ 0x81 }, 7, at(RUNTIME, static_cast<int32_t>(offsetof(Runtime, depth))));
+                as.dword(static_cast<uint32_t>(MAX_STACK_DEPTH));
+                std::size_t const tooDeep{ as.jump(CC_A) };
+                for (uint32_t i{ 0 }; i < locals; ++i)
+                {
+                    if (i < f.params) as.move(local(i), at(ARG0, 4 * static_cast<int32_t>(i)));
+                    else as.moveImm(local(i), 0);
+                }
+
+                for (uint32_t pc{ f.entry }; pc < end; ++pc)
+                {
+                    pcOffset[pc] = as.pos();
+                    Instr const& instr{ bytecode.code[pc] };
+                    int32_t const d{ depthAt[pc] };
+                    bool const fuses{ pc + 1 < end && !isTarget[pc + 1] };
+                    switch (instr.op)
+                    {
+                    case Op::CONST:
+                    {
+                        Op const next{ fuses ? bytecode.code[pc + 1].op : Op::CONST };
+                        if (next == Op::ADD || next == Op::SUB || next == Op::MUL || next == Op::EQ || next == Op::LT || next == Op::GT)
+                        {
+                            arithmetic(next, slot(d - 1), nullptr, instr.arg);
+                            ++pc;
+                            if (next == Op::EQ || next == Op::LT || next == Op::GT)
+                                pc += condition(next, slot(d - 1), pc + 1);
+                        }
+                        else
+                            as.moveImm(slot(d), instr.arg);
+                        break;
+                    }
+                    case Op::LOAD:
+                        as.move(slot(d), local(static_cast<uint32_t>(instr.arg)));
+                        break;
+                    case Op::STORE:
+                        as.move(local(static_cast<uint32_t>(instr.arg)), slot(d - 1));
+                        break;
+                    case Op::ADD:
+                    case Op::SUB:
+                    case Op::MUL:
+                    {
+                        Loc const rhs{ slot(d - 1) };
+                        arithmetic(instr.op, slot(d - 2), &rhs, 0);
+                        break;
+                    }
+                    case Op::EQ:
+                    case Op::LT:
+                    case Op::GT:
+                    {
+                        Loc const rhs{ slot(d - 1) };
+                        arithmetic(instr.op, slot(d - 2), &rhs, 0);
+                        pc += condition(instr.op, slot(d - 2), pc + 1);
+                        break;
+                    }
+                    case Op::DIV:
+                        divide(slot(d - 2), slot(d - 1));
+                        break;
+                    case Op::NEG:
+                        as.op({ 0xF7 }, 3, slot(d - 1));
+                        break;
+                    case Op::PUSH:
+                    {
+                        Loc const value{ slot(d - 1) };
+                        callHelper(pushValue, &value, 0, d - 1);
+                        checkFailed();
+                        break;
+                    }
+                    case Op::POP:
+                        callHelper(popValue, nullptr, 0, d);
+                        checkFailed();
+                        as.store(slot(d), RAX);
+                        break;
+                    case Op::CALL:
+                    {
+                        int32_t const params{ static_cast<int32_t>(bytecode.functions[static_cast<std::size_t>(instr.arg)].params) };
+                        spill(d);
+                        as.op({ 0x8D }, ARG0, home(d - params), true);
+                        as.moveWide(ARG1, RUNTIME);
+                        calls.push_back({ as.call(), static_cast<uint32_t>(instr.arg) });
+                        as.test(RAX);
+                        toFail.push_back(as.jump(CC_NE));
+                        reload(d - params);
+                        break;
+                    }
+                    case Op::RET:
+                        as.op({ 0xFF }, 1, at(RUNTIME, static_cast<int32_t>(offsetof(Runtime, depth))));
+                        as.op({ 0x33 }, RAX, inReg(RAX));
+                        toExit.push_back(as.jump());
+                        break;
+                    case Op::DESTROY:
+                        callHelper(destroyValue, nullptr, 0, d);
+                        checkFailed();
+                        break;
+                    case Op::NEW:
+                        callOperands(newCells, d - 2, 2);
+                        as.store(slot(d - 2), RAX);
+                        break;
+                    case Op::CELL_LOAD:
+                        callOperands(loadCell, d - 2, 2);
+                        as.store(slot(d - 2), RAX);
+                        break;
+                    case Op::CELL_STORE:
+                        callOperands(storeCell, d - 3, 3);
+                        break;
+                    case Op::DELETE:
+                        callOperands(deleteCells, d - 1, 1);
+                        break;
+                    case Op::PIN:
+                        callOperands(pinCells, d - 1, 1);
+                        break;
+                    case Op::PRINT_STR:
+                        callHelper(printString, nullptr, instr.arg, d);
+                        break;
+                    case Op::PRINT_INT:
+                    {
+                        Loc const value{ slot(d - 1) };
+                        callHelper(printInt, &value, 0, d - 1);
+                        break;
+                    }
+                    case Op::PRINT_END:
+                        callHelper(printEnd, nullptr, 0, d);
+                        break;
+                    case Op::JUMP:
+                        jumps.push_back({ as.jump(), static_cast<uint32_t>(instr.arg) });
+                        break;
+                    case Op::JUMP_IF:
+                        as.load(RAX, slot(d - 1));
+                        as.test(RAX);
+                        jumps.push_back({ as.jump(CC_NE), static_cast<uint32_t>(instr.arg) });
+                        break;
+                    }
+                }
+
+                // Error paths, out of line after the body.
+                std::size_t const divideStub{ as.pos() };
+                callHelper(divideByZero, nullptr, 0, 0);
+                toFail.push_back(as.jump());
+                std::size_t const depthStub{ as.pos() };
+                callHelper(depthExceeded, nullptr, static_cast<int32_t>(index), 0);
+                std::size_t const failLabel{ as.pos() };
+                as.moveImm(inReg(RAX), 1);
+                std::size_t const exitLabel{ as.pos() };
+                as.op({ 0x8D }, RSP, at(RBP, -SAVED_BYTES), true);
+                as.pop(R15);
+                as.pop(R14);
+                as.pop(R13);
+                as.pop(R12);
+                as.pop(RBX);
+                as.pop(RBP);
+                as.byte(0xC3);
+
+                as.patch(tooDeep, depthStub);
+                for (std::size_t p : toDivideByZero) as.patch(p, divideStub);
+                for (std::size_t p : toFail) as.patch(p, failLabel);
+                for (std::size_t p : toExit) as.patch(p, exitLabel);
+                return true;
+            }
+        };
+    }
+
+    bool jitCompile(Bytecode const& bytecode, JitProgram& out)
+    {
+        std::vector<uint8_t> bytes{};
+        out.entries.clear();
+        if (!Translator{ bytecode, bytes }.translate(out.entries))
+        {
+            std::cerr << "JIT Error: unsupported bytecode shape\n";
+            return false;
+        }
+        if (!out.code.load(bytes))
+        {
+            std::cerr << "JIT Error: could not map executable memory\n";
+            return false;
+        }
+        return true;
+    }
+
+    bool jitRun(JitProgram const& program, Bytecode const& bytecode, StringTable const& strings)
+    {
+        Runtime rt{};
+        rt.bytecode = &bytecode;
+        rt.strings = &strings;
+        std::vector<int32_t> const args(bytecode.functions[bytecode.main].params + 1, 0);
+        Entry const entry{ reinterpret_cast<Entry>(const_cast<void*>(program.code.at(program.entries[bytecode.main]))) };
+        return entry(args.data(), &rt) == 0;
+    }
+#else
+    bool jitCompile(Bytecode const&, JitProgram&)
+    {
+        std::cerr << "JIT Error: native code generation needs an x86-64 target\n";
+        return false;
+    }
+
+    bool jitRun(JitProgram const&, Bytecode const&, StringTable const&)
+    {
+        return false;
+    }
+#endif
+}
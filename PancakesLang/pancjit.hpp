@@ -0,0 +1,55 @@
+#ifndef PANCJIT_HPP
+#define PANCJIT_HPP
+
+#include "pancexpr.hpp"
+#include "pancvm.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Native code generation targets x86-64 only. Elsewhere jitCompile reports that
+// it is unavailable, and callers keep using the bytecode VM.
+#if defined(__x86_64__) || defined(_M_X64)
+#define PANC_JIT 1
+#else
+#define PANC_JIT 0
+#endif
+
+namespace panc
+{
+    // Owns the executable pages for generated machine code. Bytes are copied in
+    // while the pages are read-write, then the pages become read-execute, so
+    // they are never writable and executable at once.
+    class NativeCode
+    {
+    public:
+        NativeCode() = default;
+        ~NativeCode();
+        NativeCode(NativeCode const&) = delete;
+        NativeCode& operator=(NativeCode const&) = delete;
+
+        bool load(std::vector<uint8_t> const& bytes);
+        void release();
+        void const* at(std::size_t offset) const { return static_cast<uint8_t const*>(pages) + offset; }
+
+    private:
+        void* pages{ nullptr };
+        std::size_t size{ 0 };
+    };
+
+    struct JitProgram
+    {
+        NativeCode code{};
+        std::vector<uint32_t> entries{};    // native offset of each Bytecode function
+    };
+
+    // Translates compiled bytecode to x86-64. Operand stack depths are known at
+    // compile time, so every stack slot becomes a fixed register or frame cell.
+    // The first four locals and the first four stack slots live in registers.
+    bool jitCompile(Bytecode const& bytecode, JitProgram& out);
+
+    // Runs main as native code. Output and runtime errors match run().
+    bool jitRun(JitProgram const& program, Bytecode const& bytecode, StringTable const& strings);
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef PANCKEYWORD_HPP
+#define PANCKEYWORD_HPP
+
+#include "panctoken.hpp"
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+namespace panc
+{
+    struct Keyword
+    {
+        std::string_view word{};
+        TokenType type{ TokenType::IDENTIFIER };
+    };
+
+    // Spelled in lower case; matching is case-insensitive.
+    inline constexpr Keyword KEYWORDS[]
+    {
+        {"class", TokenType::K_CLASS},
+        {"section", TokenType::K_SECTION},
+        {"function", TokenType::K_FUNCTION},
+        {"procedure", TokenType::K_PROCEDURE},
+        {"only", TokenType::K_ONLY},
+        {"as", TokenType::K_AS},
+        {"main", TokenType::K_MAIN},
+        {"return", TokenType::K_RETURN},
+        {"is", TokenType::K_IS},
+        {"do", TokenType::K_DO},
+        {"end", TokenType::K_END},
+        {"loop", TokenType::K_LOOP},
+        {"for", TokenType::K_FOR},
+        {"in", TokenType::K_IN},
+        {"local", TokenType::K_LOCAL},
+        {"manual", TokenType::K_MANUAL},
+        {"pin", TokenType::K_PIN},
+        {"pinned", TokenType::K_PINNED},
+        {"push", TokenType::K_PUSH},
+        {"pop", TokenType::K_POP},
+        {"new", TokenType::K_NEW},
+        {"delete", TokenType::K_DELETE},
+        {"destroy", TokenType::K_DESTROY},
+        {"leave", TokenType::K_LEAVE},
+        {"from", TokenType::K_FROM},
+        {"forth", TokenType::K_FORTH},
+        {"lowlevel", TokenType::K_LOWLEVEL},
+        {"structure", TokenType::K_STRUCTURE},
+        {"allocate", TokenType::K_ALLOCATE},
+        {"cells", TokenType::K_CELLS},
+        {"sizeof", TokenType::K_SIZEOF}
+    };
+
+    namespace keyword
+    {
+        constexpr std::size_t SLOTS{ std::bit_ceil(std::size(KEYWORDS) * 4) };
+        constexpr std::uint32_t MAX_SEED{ 1u << 16 };
+
+        // FNV-1a over ASCII-folded bytes. Identifier bytes are [A-Za-z0-9_], for which
+        // "| 0x20" is an exact case fold.
+        constexpr std::uint32_t hash(char const* s, std::size_t len, std::uint32_t seed)
+        {
+            std::uint32_t h{ 2166136261u ^ seed };
+            for (std::size_t i{ 0 }; i < len; ++i)
+                h = (h ^ (static_cast<unsigned char>(s[i]) | 0x20u)) * 16777619u;
+            return h ^ (h >> 16);
+        }
+
+        constexpr std::uint32_t findSeed()
+        {
+            for (std::uint32_t seed{ 0 }; seed < MAX_SEED; ++seed)
+            {
+                bool used[SLOTS]{};
+                bool collision{ false };
+                for (Keyword const& kw : KEYWORDS)
+                {
+                    std::size_t const slot{ hash(kw.word.data(), kw.word.size(), seed) & (SLOTS - 1) };
+                    if (used[slot]) { collision = true; break; }
+                    used[slot] = true;
+                }
+                if (!collision) return seed;
+            }
+            return MAX_SEED;
+        }
+
+        constexpr std::uint32_t SEED{ findSeed() };
+        static_assert(SEED < MAX_SEED, "no collision-free seed for the keyword table; grow SLOTS");
+
+        constexpr std::array<Keyword, SLOTS> buildTable()
+        {
+            std::array<Keyword, SLOTS> table{};
+            for (Keyword const& kw : KEYWORDS)
+                table[hash(kw.word.data(), kw.word.size(), SEED) & (SLOTS - 1)] = kw;
+            return table;
+        }
+
+        inline constexpr std::array<Keyword, SLOTS> TABLE{ buildTable() };
+    }
+
+    inline TokenType classifyWord(char const* s, std::size_t len)
+    {
+        Keyword const& slot{ keyword::TABLE[keyword::hash(s, len, keyword::SEED) & (keyword::SLOTS - 1)] };
+        if (slot.word.size() != len) return TokenType::IDENTIFIER;
+        for (std::size_t i{ 0 }; i < len; ++i)
+            if ((static_cast<unsigned char>(s[i]) | 0x20u) != static_cast<unsigned char>(slot.word[i]))
+                return TokenType::IDENTIFIER;
+        return slot.type;
+    }
+}
+
+#endif
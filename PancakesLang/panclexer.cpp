@@ -1,91 +1,105 @@
 #include "panclexer.hpp"
-#include "pancstring.hpp"
+#include "panckeyword.hpp"
+#include <algorithm>
 #include <cctype>
 #include <cstring>
-#include <iostream>
-#include <fstream>
+#include <thread>
+#include <vector>
 
-namespace
+Lexer::Lexer(char const* src, std::size_t len) : input(src), length(len) {}
+
+Lexer::Lexer(panc::SourceBuffer const& source) : input(source.data()), length(source.size()) {}
+
+std::size_t Lexer::tokenizeInto(panc::TokenBuffer& target)
 {
-    constexpr struct { char const* word; panc::TokenType type; } keywords[]
-    {
-        {"class", panc::TokenType::K_CLASS},
-        {"section", panc::TokenType::K_SECTION},
-        {"function", panc::TokenType::K_FUNCTION},
-        {"procedure", panc::TokenType::K_PROCEDURE},
-        {"as", panc::TokenType::K_AS},
-        {"main", panc::TokenType::K_MAIN},
-        {"return", panc::TokenType::K_RETURN},
-        {"is", panc::TokenType::K_IS},
-        {"do", panc::TokenType::K_DO},
-        {"end", panc::TokenType::K_END}
-    };
-
-    bool ci_equal_n(char const* a, std::size_t len, char const* b)
+    std::size_t const first{ target.size() };
+    while (true)
     {
-        std::size_t const blen{ std::strlen(b) };
-        if (len != blen) return false;
-        for (std::size_t i{ 0 }; i < len; ++i)
-            if ((static_cast<unsigned char>(a[i]) & ~0x20) != (static_cast<unsigned char>(b[i]) & ~0x20))
-                return false;
-        return true;
+        panc::Token const t{ nextToken() };
+        target.push_back(t);
+        if (t.type == panc::TokenType::END_OF_FILE)
+            break;
     }
+    return target.size() - first;
 }
 
-Lexer::Lexer(char const* src, std::size_t len) : input(src), length(len) {}
+Lexer::Lexer(char const* src, std::size_t begin, std::size_t end) : input(src), length(end), position(begin) {}
 
-std::size_t Lexer::tokenizeInto(panc::Token* target, std::size_t max)
+std::size_t Lexer::tokenizeParallel(panc::TokenBuffer& target, unsigned threads, std::size_t minChunk)
 {
-    std::size_t count{ 0 };
-    while (count < max)
+    std::size_t end{ length };
+    if (void const* nul{ std::memchr(input + position, '\0', length - position) })
+        end = static_cast<std::size_t>(static_cast<char const*>(nul) - input);
+
+    std::size_t const span{ end - position };
+    std::size_t const chunks{ std::min<std::size_t>(threads, span / (minChunk ? minChunk : 1)) };
+    if (chunks < 2) return tokenizeInto(target);
+
+    std::vector<std::size_t> bounds{ position };
+    for (std::size_t k{ 1 }; k < chunks; ++k)
+    {
+        std::size_t const split{ splitAfter(bounds.back(), position + span / chunks * k, end) };
+        if (split >= end) break;
+        if (split > bounds.back()) bounds.push_back(split);
+    }
+    bounds.push_back(end);
+
+    std::size_t const parts{ bounds.size() - 1 };
+    std::vector<panc::TokenBuffer> pieces(parts, panc::TokenBuffer{ input });
+    auto const lexChunk{ [&](std::size_t i)
     {
-        panc::Token const t{ next() };
-        if (t.type != panc::TokenType::UNKNOWN)
+        Lexer chunk{ input, bounds[i], bounds[i + 1] };
+        while (true)
         {
-            target[count++] = t;
-            if (t.type == panc::TokenType::END_OF_FILE)
-                break;
+            panc::Token const t{ chunk.nextToken() };
+            if (t.type == panc::TokenType::END_OF_FILE && i + 1 < parts) break;
+            pieces[i].push_back(t);
+            if (t.type == panc::TokenType::END_OF_FILE) break;
         }
-    }
-    return count;
+    } };
+
+    std::vector<std::thread> workers{};
+    workers.reserve(parts - 1);
+    for (std::size_t i{ 1 }; i < parts; ++i)
+        workers.emplace_back(lexChunk, i);
+    lexChunk(0);
+    for (std::thread& w : workers)
+        w.join();
+
+    std::size_t const first{ target.size() };
+    for (panc::TokenBuffer const& piece : pieces)
+        target.append(piece);
+    position = end;
+    return target.size() - first;
 }
 
-std::size_t Lexer::tokenizeToStream(std::ostream& out) const
+// First line start at or after `target` that is not inside a string literal, scanning
+// quote state forward from `from`, which must itself be outside a string. Returns
+// `end` when there is none.
+std::size_t Lexer::splitAfter(std::size_t from, std::size_t target, std::size_t end) const
 {
-    std::size_t count{ 0 };
-    Lexer copy{ *this };
-    while (true)
+    std::size_t p{ from };
+    while (p < end)
     {
-        panc::Token const t{ copy.next() };
-        if (t.type != panc::TokenType::UNKNOWN)
+        char const c{ input[p] };
+        if (c == '"' || c == '\'')
         {
-            out << "Token Type: <" << panc::TokenTypeToString(t.type)
-                << "> Word: \"" << t.value
-                << "\" Position: { Line: " << t.position.line
-                << ", Column: " << t.position.column << " }\n";
-            count++;
+            char const* const close{ scan->findQuote(input + p + 1, input + end, c) };
+            if (close >= input + end) return end;
+            p = static_cast<std::size_t>(close - input) + 1;
+            continue;
         }
-        if (t.type == panc::TokenType::END_OF_FILE)
-            break;
+        if (c == '\n' && p >= target) return p + 1;
+        ++p;
     }
-    return count;
-}
-
-std::ostream& operator<<(std::ostream& out, Lexer const& lexer)
-{
-    lexer.tokenizeToStream(out);
-    return out;
+    return end;
 }
 
-void operator>>(Lexer const& lexer, char const* fileName)
+panc::Token Lexer::nextToken()
 {
-    char outName[512]{};
-    panc::strcpy(outName, sizeof(outName), fileName);
-    if (char* dot{ panc::strrchr(outName, '.') }) *dot = '\0';
-    panc::strcat(outName, sizeof(outName), "Token.txt");
-    std::ofstream out{ outName, std::ios::out | std::ios::trunc };
-    if (!out) return;
-    lexer.tokenizeToStream(out);
+    while (true)
+        if (panc::Token const t{ next() }; t.type != panc::TokenType::UNKNOWN)
+            return t;
 }
 
 bool Lexer::eof() const
@@ -102,55 +116,49 @@ char Lexer::advance()
 {
     char const c{ peek() };
     ++position;
-    if (c == '\n') { ++line; column = 1; }
-    else ++column;
     return c;
 }
 
+void Lexer::advanceTo(char const* stop)
+{
+    position = static_cast<std::size_t>(stop - input);
+}
+
 void Lexer::skip()
 {
-    while (!eof())
-        if (char const c{ peek() }; std::isspace(static_cast<unsigned char>(c)) || static_cast<unsigned char>(c) == 0xA0)
-            advance();
-        else
-            break;
+    advanceTo(scan->skipSpace(input + position, input + length));
 }
 
 panc::Token Lexer::next()
 {
     skip();
-    std::size_t const ln{ line }, col{ column };
-    if (eof()) return { panc::TokenType::END_OF_FILE, "", { ln, col } };
+    std::uint32_t const at{ static_cast<std::uint32_t>(position) };
+    if (eof()) return { panc::TokenType::END_OF_FILE, "", at };
     char const c{ advance() };
 
     if (std::isalpha(static_cast<unsigned char>(c)) || c == '_')
     {
         std::size_t const start{ position - 1 };
-        while (!eof() && (std::isalnum(static_cast<unsigned char>(peek())) || peek() == '_'))
-            advance();
-        std::size_t len{ position - start };
-        for (auto const& kw : keywords)
-            if (ci_equal_n(input + start, len, kw.word))
-                return { kw.type, {input + start, len}, { ln, col } };
-        return { panc::TokenType::IDENTIFIER, {input + start, len}, { ln, col } };
+        advanceTo(scan->skipIdent(input + position, input + length));
+        std::size_t const len{ position - start };
+        return { panc::classifyWord(input + start, len), {input + start, len}, at };
     }
 
     if (std::isdigit(static_cast<unsigned char>(c)))
     {
         std::size_t const start{ position - 1 };
-        while (!eof() && std::isdigit(static_cast<unsigned char>(peek())))
-            advance();
-        return { panc::TokenType::NUMBER, {input + start, position - start}, { ln, col } };
+        advanceTo(scan->skipDigits(input + position, input + length));
+        return { panc::TokenType::NUMBER, {input + start, position - start}, at };
     }
 
     if (c == '"' || c == '\'')
     {
         char const q{ c };
         std::size_t const start{ position };
-        while (!eof() && peek() != q) advance();
-        if (eof()) return { panc::TokenType::UNTERMINATED_STRING, {input + start, position - start}, { ln, col } };
+        advanceTo(scan->findQuote(input + position, input + length, q));
+        if (eof()) return { panc::TokenType::UNTERMINATED_STRING, {input + start, position - start}, at };
         advance();
-        return { panc::TokenType::STRING, {input + start, position - start - 1}, { ln, col } };
+        return { panc::TokenType::STRING, {input + start, position - start - 1}, at };
     }
 
     panc::TokenType t{};
@@ -165,7 +173,22 @@ panc::Token Lexer::next()
     case '=': t = panc::TokenType::EQUAL; break;
     case '+': t = panc::TokenType::PLUS; break;
     case '-': t = panc::TokenType::MINUS; break;
-    default: return { panc::TokenType::UNKNOWN, "", { ln, col } };
+    case '*': t = panc::TokenType::STAR; break;
+    case '/': t = panc::TokenType::SLASH; break;
+    case '>': t = panc::TokenType::GREATER; break;
+    case '!': t = panc::TokenType::BANG; break;
+    case '@': t = panc::TokenType::AT; break;
+    case '{': t = panc::TokenType::LBRACE; break;
+    case '}': t = panc::TokenType::RBRACE; break;
+    case '<':
+        if (peek() == '-')
+        {
+            advance();
+            return { panc::TokenType::ARROW, {input + (position - 2), 2}, at };
+        }
+        t = panc::TokenType::LESS;
+        break;
+    default: return { panc::TokenType::UNKNOWN, "", at };
     }
-    return { t, {input + (position - 1), 1}, { ln, col } };
+    return { t, {input + (position - 1), 1}, at };
 }
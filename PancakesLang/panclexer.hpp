@@ -2,30 +2,35 @@
 #define PANCLEXER_HPP
 
 #include <cstddef>
-#include <ostream>
 #include "panctoken.hpp"
-#include "pancvar.hpp"
+#include "pancsource.hpp"
+#include "pancscan.hpp"
+#include "panctokens.hpp"
+#include "pancdef.hpp"
 
 class Lexer
 {
     char const* input;
     std::size_t length;
     std::size_t position{ 0 };
-    std::size_t line{ 1 };
-    std::size_t column{ 1 };
+    panc::scan::Kernels const* scan{ &panc::scan::kernels() };
 
 public:
     Lexer(char const* src, std::size_t len);
-    std::size_t tokenizeInto(panc::Token* target, std::size_t max);
-    std::size_t tokenizeToStream(std::ostream& out) const;
-
-    friend std::ostream& operator<<(std::ostream& out, Lexer const& lexer);
-    friend void operator>>(Lexer const& lexer, char const* fileName);
+    explicit Lexer(panc::SourceBuffer const& source);
+    std::size_t tokenizeInto(panc::TokenBuffer& target);
+    std::size_t tokenizeParallel(panc::TokenBuffer& target, unsigned threads,
+        std::size_t minChunk = panc::PARALLEL_LEX_MIN_CHUNK);
+    panc::Token nextToken();
 
 private:
+    Lexer(char const* src, std::size_t begin, std::size_t end);
+    std::size_t splitAfter(std::size_t from, std::size_t target, std::size_t end) const;
+
     bool eof() const;
     char peek() const;
     char advance();
+    void advanceTo(char const* stop);
     void skip();
     panc::Token next();
 };
@@ -0,0 +1,267 @@
+#include "pancopt.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+namespace panc
+{
+    namespace
+    {
+        bool foldBinary(BinaryOp op, int32_t l, int32_t r, int32_t& out)
+        {
+            uint32_t const a{ static_cast<uint32_t>(l) };
+            uint32_t const b{ static_cast<uint32_t>(r) };
+            switch (op)
+            {
+            case BinaryOp::ADD: out = static_cast<int32_t>(a + b); return true;
+            case BinaryOp::SUB: out = static_cast<int32_t>(a - b); return true;
+            case BinaryOp::MUL: out = static_cast<int32_t>(a * b); return true;
+            case BinaryOp::DIV:
+                if (r == 0) return false;
+                out = (l == INT32_MIN && r == -1) ? INT32_MIN : l / r;
+                return true;
+            case BinaryOp::EQ: out = l == r; return true;
+            case BinaryOp::LT: out = l < r; return true;
+            case BinaryOp::GT: out = l > r; return true;
+            }
+            return false;
+        }
+
+        // Open-addressing set of canonical nodes, keyed on kind, operator and
+        // payload. Children are already canonical when a parent is looked up,
+        // so comparing child pointers compares whole subtrees.
+        class ConsTable
+        {
+            std::vector<Expr*> slots;
+            std::size_t count{ 0 };
+
+            static uint64_t key(Expr const* e)
+            {
+                uint64_t a{}, b{};
+                switch (e->kind)
+                {
+                case ExprKind::LITERAL: a = static_cast<uint32_t>(e->getLiteralValue()); break;
+                case ExprKind::STRING: a = e->getStringIdx(); break;
+                case ExprKind::VARIABLE: a = e->getVariableNameIdx(); break;
+                case ExprKind::BINARY:
+                    a = reinterpret_cast<uintptr_t>(e->getLhs());
+                    b = reinterpret_cast<uintptr_t>(e->getRhs());
+                    break;
+                case ExprKind::UNARY: a = reinterpret_cast<uintptr_t>(e->getOperand()); break;
+                case ExprKind::FUNC_CALL:
+                case ExprKind::POP:
+                    break;
+                }
+                uint64_t h{ (static_cast<uint64_t>(e->kind) << 8 | e->op) * 0x9E3779B97F4A7C15ull };
+                h = (h ^ a) * 0xFF51AFD7ED558CCDull;
+                h = (h ^ b) * 0xC4CEB9FE1A85EC53ull;
+                return h ^ (h >> 29);
+            }
+
+            static bool same(Expr const* x, Expr const* y)
+            {
+                if (x->kind != y->kind || x->op != y->op) return false;
+                switch (x->kind)
+                {
+                case ExprKind::LITERAL: return x->getLiteralValue() == y->getLiteralValue();
+                case ExprKind::STRING: return x->getStringIdx() == y->getStringIdx();
+                case ExprKind::VARIABLE: return x->getVariableNameIdx() == y->getVariableNameIdx();
+                case ExprKind::BINARY: return x->getLhs() == y->getLhs() && x->getRhs() == y->getRhs();
+                case ExprKind::UNARY: return x->getOperand() == y->getOperand();
+                case ExprKind::FUNC_CALL:
+                case ExprKind::POP:
+                    return false;
+                }
+                return false;
+            }
+
+            void grow()
+            {
+                std::vector<Expr*> old(slots.size() ? slots.size() * 2 : 64, nullptr);
+                old.swap(slots);
+                count = 0;
+                for (Expr* e : old)
+                    if (e) intern(e);
+            }
+
+        public:
+            // Returns the canonical node equal to e, inserting e if there is none.
+            Expr* intern(Expr* e)
+            {
+                if ((count + 1) * 2 > slots.size()) grow();
+                std::size_t const mask{ slots.size() - 1 };
+                for (std::size_t i{ static_cast<std::size_t>(key(e)) & mask }; ; i = (i + 1) & mask)
+                {
+                    if (!slots[i])
+                    {
+                        slots[i] = e;
+                        ++count;
+                        return e;
+                    }
+                    if (same(slots[i], e)) return slots[i];
+                }
+            }
+        };
+
+        struct Optimizer : ExprVisitor<Optimizer, Expr*>
+        {
+            ConsTable table{};
+            OptimizeStats stats{};
+
+            Expr* share(Expr* e)
+            {
+                Expr* const canonical{ table.intern(e) };
+                if (canonical != e) ++stats.shared;
+                return canonical;
+            }
+
+            Expr* visitLiteral(Expr* e)
+            {
+                ++stats.nodesBefore;
+                return share(e);
+            }
+
+            Expr* visitString(Expr* e)
+            {
+                ++stats.nodesBefore;
+                return share(e);
+            }
+
+            Expr* visitVariable(Expr* e)
+            {
+                ++stats.nodesBefore;
+                return share(e);
+            }
+
+            Expr* visitPop(Expr* e)
+            {
+                ++stats.nodesBefore;
+                return e;
+            }
+
+            Expr* visitFuncCall(Expr* e)
+            {
+                ++stats.nodesBefore;
+                for (uint32_t i{ 0 }; i < e->getArgCount(); ++i)
+                    e->setArg(i, visit(e->getArg(i)));
+                return e;
+            }
+
+            Expr* visitUnary(Expr* e)
+            {
+                ++stats.nodesBefore;
+                Expr* const operand{ visit(e->getOperand()) };
+                if (operand->isLiteral() && e->getUnaryOp() == UnaryOp::NEG)
+                {
+                    ++stats.folded;
+                    return share(Expr::createLiteral(static_cast<int32_t>(0u - static_cast<uint32_t>(operand->getLiteralValue())), e));
+                }
+                e->unary.operand = operand;
+                return share(e);
+            }
+
+            Expr* visitBinary(Expr* e)
+            {
+                ++stats.nodesBefore;
+                Expr* const lhs{ visit(e->getLhs()) };
+                Expr* const rhs{ visit(e->getRhs()) };
+                int32_t value{};
+                if (lhs->isLiteral() && rhs->isLiteral() && foldBinary(e->getBinaryOp(), lhs->getLiteralValue(), rhs->getLiteralValue(), value))
+                {
+                    ++stats.folded;
+                    return share(Expr::createLiteral(value, e));
+                }
+                e->binary.lhs = lhs;
+                e->binary.rhs = rhs;
+                return share(e);
+            }
+        };
+
+        void countReachable(Expr const* e, std::unordered_set<Expr const*>& seen)
+        {
+            if (!seen.insert(e).second) return;
+            switch (e->kind)
+            {
+            case ExprKind::BINARY:
+                countReachable(e->getLhs(), seen);
+                countReachable(e->getRhs(), seen);
+                break;
+            case ExprKind::UNARY:
+                countReachable(e->getOperand(), seen);
+                break;
+            case ExprKind::FUNC_CALL:
+                for (uint32_t i{ 0 }; i < e->getArgCount(); ++i)
+                    countReachable(e->getArg(i), seen);
+                break;
+            default:
+                break;
+            }
+        }
+
+        void optimizeBody(Stmt* body, Optimizer& optimizer)
+        {
+            for (Stmt* s{ body }; s; s = s->next)
+                switch (s->kind)
+                {
+                case StmtKind::CALL:
+                    s->call.expr = optimizer.visit(s->call.expr);
+                    break;
+                case StmtKind::ASSIGN:
+                    s->assign.target = optimizer.visit(s->assign.target);
+                    s->assign.value = optimizer.visit(s->assign.value);
+                    break;
+                case StmtKind::PUSH:
+                    s->push.value = optimizer.visit(s->push.value);
+                    break;
+                case StmtKind::FOR:
+                    s->loop.first = optimizer.visit(s->loop.first);
+                    s->loop.last = optimizer.visit(s->loop.last);
+                    optimizeBody(s->loop.body, optimizer);
+                    break;
+                case StmtKind::DESTROY:
+                    break;
+                }
+        }
+
+        void countBody(Stmt const* body, std::unordered_set<Expr const*>& seen)
+        {
+            for (Stmt const* s{ body }; s; s = s->next)
+                switch (s->kind)
+                {
+                case StmtKind::CALL:
+                    countReachable(s->call.expr, seen);
+                    break;
+                case StmtKind::ASSIGN:
+                    countReachable(s->assign.target, seen);
+                    countReachable(s->assign.value, seen);
+                    break;
+                case StmtKind::PUSH:
+                    countReachable(s->push.value, seen);
+                    break;
+                case StmtKind::FOR:
+                    countReachable(s->loop.first, seen);
+                    countReachable(s->loop.last, seen);
+                    countBody(s->loop.body, seen);
+                    break;
+                case StmtKind::DESTROY:
+                    break;
+                }
+        }
+    }
+
+    OptimizeStats optimize(Program& program)
+    {
+        Optimizer optimizer{};
+        for (Procedure* proc{ program.procedures }; proc; proc = proc->next)
+            optimizeBody(proc->body, optimizer);
+
+        std::unordered_set<Expr const*> seen{};
+        for (Procedure const* proc{ program.procedures }; proc; proc = proc->next)
+            countBody(proc->body, seen);
+
+        OptimizeStats stats{ optimizer.stats };
+        stats.nodesAfter = static_cast<uint32_t>(seen.size());
+        return stats;
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef PANCOPT_HPP
+#define PANCOPT_HPP
+
+#include "pancast.hpp"
+#include "pancexpr.hpp"
+#include <cstdint>
+
+namespace panc
+{
+    struct OptimizeStats
+    {
+        uint32_t nodesBefore{ 0 };
+        uint32_t nodesAfter{ 0 };
+        uint32_t folded{ 0 };
+        uint32_t shared{ 0 };
+
+        [[nodiscard]] uint32_t removed() const
+        {
+            return nodesBefore - nodesAfter;
+        }
+    };
+
+    // Folds operators whose operands are all literals, then hash-conses the
+    // program's expressions so structurally equal pure subtrees share one node.
+    // Works in place on the arena nodes; the trees become DAGs afterwards.
+    // Calls and pops are never shared, and division by zero is left for the
+    // interpreter to report. Recurses as deep as the tallest tree, which the
+    // parser keeps within MAX_STACK_DEPTH; neither rewrite makes a tree taller.
+    OptimizeStats optimize(Program& program);
+}
+
+#endif
@@ -1,104 +1,1155 @@
 #include "pancparser.hpp"
 #include "pancstring.hpp"
+#include "pancstruct.hpp"
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
 #include <iostream>
 
-Parser::Parser(panc::Token* t, std::size_t c) : tokens(t), count(c) {}
+namespace
+{
+    bool ci_equal(std::string_view a, std::string_view b)
+    {
+        if (a.size() != b.size()) return false;
+        for (std::size_t i{ 0 }; i < a.size(); ++i)
+            if ((static_cast<unsigned char>(a[i]) | 0x20) != (static_cast<unsigned char>(b[i]) | 0x20))
+                return false;
+        return true;
+    }
+
+    struct Infix
+    {
+        panc::BinaryOp op;
+        int power;
+    };
+
+    constexpr int PREFIX_POWER{ 50 };
+    constexpr uint32_t MAX_MANUAL_CELLS{ 1u << 16 };
+
+    bool infixOf(panc::TokenType t, Infix& out)
+    {
+        switch (t)
+        {
+        case panc::TokenType::EQUAL: out = { panc::BinaryOp::EQ, 10 }; return true;
+        case panc::TokenType::LESS: out = { panc::BinaryOp::LT, 20 }; return true;
+        case panc::TokenType::GREATER: out = { panc::BinaryOp::GT, 20 }; return true;
+        case panc::TokenType::PLUS: out = { panc::BinaryOp::ADD, 30 }; return true;
+        case panc::TokenType::MINUS: out = { panc::BinaryOp::SUB, 30 }; return true;
+        case panc::TokenType::STAR: out = { panc::BinaryOp::MUL, 40 }; return true;
+        case panc::TokenType::SLASH: out = { panc::BinaryOp::DIV, 40 }; return true;
+        default: return false;
+        }
+    }
+}
+
+Parser::Parser(TokenCursor& cursor, panc::CompilationContext& context)
+    : tokens(cursor), lines(context.lines), arena(context.nodes), strings(context.strings), syntaxErrors(context.syntaxErrors) {}
 
-bool Parser::run()
+panc::Program* Parser::parse()
 {
-    if (!validateStructure()) return false;
-    cursor = 0;
-    while (!atEnd())
+    parseStack.clear();
+    syntaxErrors.clear();
+
+    panc::Program* const program{ make<panc::Program>(0) };
+    if (!program) return nullptr;
+    panc::Procedure** tail{ &program->procedures };
+    panc::Class** classTail{ &program->classes };
+    currentClass = nullptr;
+    fileStructures = nullptr;
+    while (!outOfMemory && !atEnd())
     {
-        if (match(panc::TokenType::K_PROCEDURE))
+        panc::Token const tok{ peek() };
+        switch (tok.type)
         {
-            if (peek().type == panc::TokenType::IDENTIFIER) consume();
-            if (match(panc::TokenType::K_AS) && match(panc::TokenType::K_MAIN))
+        case panc::TokenType::K_PROCEDURE:
+            if (panc::Procedure* const proc{ parseProcedure() })
             {
-                executeMain();
-                return true;
+                if (proc->isMain)
+                {
+                    if (program->main) addError("Duplicate main procedure", proc->offset);
+                    else program->main = proc;
+                }
+                *tail = proc;
+                tail = &proc->next;
+                ++program->procedure_count;
             }
+            break;
+        case panc::TokenType::K_CLASS:
+            consume();
+            openBlock(tok.type, tok.offset);
+            if (panc::Class* const cls{ parseClassHeader(tok) })
+            {
+                *classTail = cls;
+                classTail = &cls->next;
+                currentClass = cls;
+            }
+            break;
+        case panc::TokenType::K_FUNCTION:
+            consume();
+            openBlock(tok.type, tok.offset);
+            break;
+        case panc::TokenType::K_END:
+            closeBlock();
+            if (!isOpen(panc::TokenType::K_CLASS, parseStack.size())) currentClass = nullptr;
+            break;
+        case panc::TokenType::K_LOWLEVEL:
+            parseLowLevel();
+            break;
+        case panc::TokenType::K_MANUAL:
+            parseManual();
+            break;
+        case panc::TokenType::K_STRUCTURE:
+            parseStructure();
+            break;
+        case panc::TokenType::IDENTIFIER:
+            if (currentClass && isTypeName(tok) && peek(1).type == panc::TokenType::LBRACE) parseClassVars();
+            else consume();
+            break;
+        case panc::TokenType::K_SECTION:
+            // The section name may itself be a keyword ("section function").
+            consume();
+            if (!atEnd()) consume();
+            break;
+        default:
+            consume();
+            break;
         }
-        consume();
     }
-    std::cerr << "Runtime Error: main procedure not found\n";
-    return false;
+    closeBlocksTo(0);
+    reportErrors();
+    return program;
+}
+
+bool Parser::hasErrors() const
+{
+    return !syntaxErrors.empty();
 }
 
-panc::Token const& Parser::peek() const { return tokens[cursor]; }
-bool Parser::atEnd() const { return cursor >= count || peek().type == panc::TokenType::END_OF_FILE; }
-panc::Token Parser::consume() { return atEnd() ? tokens[count - 1] : tokens[cursor++]; }
+panc::Token const& Parser::peek(std::size_t ahead) { return tokens.peek(ahead); }
+bool Parser::atEnd() { return tokens.atEnd(); }
+panc::Token Parser::consume() { return tokens.consume(); }
 bool Parser::match(panc::TokenType t)
 {
     if (!atEnd() && peek().type == t) { consume(); return true; }
     return false;
 }
 
-void Parser::executeMain()
+bool Parser::expect(panc::TokenType t, char const* msg)
+{
+    if (match(t)) return true;
+    addError(msg, peek().offset);
+    return false;
+}
+
+// procedure_decl ::= "procedure" identifier ["as" identifier]? ["(" [param_list] ")"]? "is" body "end" "procedure"
+panc::Procedure* Parser::parseProcedure()
+{
+    panc::Token const start{ consume() };
+    openBlock(panc::TokenType::K_PROCEDURE, start.offset);
+    std::size_t const depth{ parseStack.size() };
+    // A procedure that fails to parse is dropped; so are the nodes built for it.
+    panc::Arena::Scope nodes{ arena };
+    panc::Procedure* const proc{ parseProcedureRest(start) };
+    if (proc) nodes.commit();
+    else synchronize(depth);
+    return proc;
+}
+
+panc::Procedure* Parser::parseProcedureRest(panc::Token const& start)
+{
+    panc::Procedure* const proc{ make<panc::Procedure>(start.offset) };
+    if (!proc) return nullptr;
+    proc->offset = start.offset;
+
+    panc::Token const name{ peek() };
+    if (!expect(panc::TokenType::IDENTIFIER, "Expected procedure name")) return nullptr;
+    proc->name_idx = intern(name.value, name.offset);
+
+    if (match(panc::TokenType::K_AS))
+    {
+        if (match(panc::TokenType::K_MAIN)) proc->isMain = true;
+        else if (!expect(panc::TokenType::IDENTIFIER, "Expected name after 'as'")) return nullptr;
+    }
+    if (match(panc::TokenType::LPAREN) && !match(panc::TokenType::RPAREN))
+    {
+        proc->params = parseParams(proc->param_count);
+        if (!proc->params || !expect(panc::TokenType::RPAREN, "Expected ')' after parameters")) return nullptr;
+    }
+    if (!expect(panc::TokenType::K_IS, "Expected 'is'")) return nullptr;
+    if (peek().type == panc::TokenType::K_LOCAL && !parseLocals(*proc)) return nullptr;
+
+    // body ::= "do" statement+
+    if (!expect(panc::TokenType::K_DO, "Expected 'do'")) return nullptr;
+    panc::Stmt** tail{ &proc->body };
+    while (!atEnd() && peek().type != panc::TokenType::K_END)
+    {
+        panc::Stmt* const stmt{ parseStatement() };
+        if (!stmt) return nullptr;
+        *tail = stmt;
+        tail = &stmt->next;
+    }
+    if (!proc->body)
+    {
+        addError("Expected at least one statement in procedure body", peek().offset);
+        return nullptr;
+    }
+
+    // Any other closer is left to synchronize(), which reports the missing 'end procedure'.
+    if (peek().type != panc::TokenType::K_END || peek(1).type != panc::TokenType::K_PROCEDURE) return nullptr;
+    consume();
+    consume();
+    parseStack.pop_back();
+    return proc;
+}
+
+// param_list ::= param ("," param)*    param ::= identifier ":" type
+panc::Param* Parser::parseParams(uint32_t& count)
+{
+    panc::Param* head{ nullptr };
+    panc::Param** tail{ &head };
+    do
+    {
+        panc::Token const name{ peek() };
+        if (!expect(panc::TokenType::IDENTIFIER, "Expected parameter name")) return nullptr;
+        if (!expect(panc::TokenType::COLON, "Expected ':' after parameter name")) return nullptr;
+        panc::Token const type{ peek() };
+        if (!isTypeName(type))
+        {
+            addError("Expected parameter type 'integer' or 'float'", type.offset);
+            return nullptr;
+        }
+        consume();
+
+        panc::Param* const param{ make<panc::Param>(name.offset) };
+        if (!param) return nullptr;
+        param->name_idx = intern(name.value, name.offset);
+        param->type_idx = intern(type.value, type.offset);
+        *tail = param;
+        tail = &param->next;
+        ++count;
+    } while (match(panc::TokenType::COMMA));
+    return head;
+}
+
+// local_block ::= "local" (type "{" identifier* "}")+
+bool Parser::parseLocals(panc::Procedure& proc)
+{
+    consume();
+    panc::Param** tail{ &proc.locals };
+    do
+    {
+        panc::Token const type{ peek() };
+        if (!isTypeName(type))
+        {
+            addError("Expected local type 'integer' or 'float'", type.offset);
+            return false;
+        }
+        consume();
+        if (!expect(panc::TokenType::LBRACE, "Expected '{' after local type")) return false;
+        while (peek().type == panc::TokenType::IDENTIFIER)
+        {
+            panc::Token const name{ consume() };
+            panc::Param* const local{ make<panc::Param>(name.offset) };
+            if (!local) return false;
+            local->name_idx = intern(name.value, name.offset);
+            local->type_idx = intern(type.value, type.offset);
+            *tail = local;
+            tail = &local->next;
+            ++proc.local_count;
+        }
+        if (!expect(panc::TokenType::RBRACE, "Expected '}' after local names")) return false;
+    } while (isTypeName(peek()));
+    return true;
+}
+
+// statement ::= push_stmt | assignment_stmt | function_call_stmt | for_stmt | destroy_stmt | leave_stmt
+//     | delete_stmt | pin_stmt
+panc::Stmt* Parser::parseStatement()
+{
+    panc::Token const first{ peek() };
+    panc::Stmt* const stmt{ make<panc::Stmt>(first.offset) };
+    if (!stmt) return nullptr;
+    stmt->offset = first.offset;
+
+    if (first.type == panc::TokenType::K_FOR)
+        return parseFor(*stmt) ? stmt : nullptr;
+    if (first.type == panc::TokenType::K_DESTROY || first.type == panc::TokenType::K_LEAVE)
+        return parseStackStatement(*stmt) ? stmt : nullptr;
+    if (first.type == panc::TokenType::K_DELETE || first.type == panc::TokenType::K_PIN)
+        return parseHeapStatement(*stmt) ? stmt : nullptr;
+    if (match(panc::TokenType::K_PUSH))
+    {
+        stmt->kind = panc::StmtKind::PUSH;
+        stmt->push.value = parseExpression(0);
+        if (!stmt->push.value) return nullptr;
+    }
+    else if (first.type == panc::TokenType::IDENTIFIER)
+    {
+        consume();
+        panc::Expr* const target{ parseNamed(first) };
+        if (!target) return nullptr;
+        if (match(panc::TokenType::ARROW))
+        {
+            stmt->kind = panc::StmtKind::ASSIGN;
+            stmt->assign.target = target;
+            stmt->assign.value = parseExpression(0);
+            if (!stmt->assign.value) return nullptr;
+        }
+        else
+        {
+            stmt->kind = panc::StmtKind::CALL;
+            stmt->call.expr = target->isFuncCall() ? target
+                : panc::Expr::createFuncCall(target->getVariableNameIdx(), nullptr, 0, target);
+        }
+    }
+    else
+    {
+        addError("Expected statement", first.offset);
+        return nullptr;
+    }
+    match(panc::TokenType::SEMICOLON);
+    return stmt;
+}
+
+// for_stmt ::= "for" identifier "in" expression "..." expression "loop" statement+ "end" "loop"
+bool Parser::parseFor(panc::Stmt& stmt)
+{
+    panc::Token const start{ consume() };
+    panc::Token const name{ peek() };
+    if (!expect(panc::TokenType::IDENTIFIER, "Expected loop variable after 'for'")) return false;
+    if (!expect(panc::TokenType::K_IN, "Expected 'in' after loop variable")) return false;
+    stmt.kind = panc::StmtKind::FOR;
+    stmt.loop.var_idx = intern(name.value, name.offset);
+    stmt.loop.first = parseExpression(0);
+    if (!stmt.loop.first) return false;
+    for (int i{ 0 }; i < 3; ++i)
+        if (!expect(panc::TokenType::DOT, "Expected '...' between loop bounds")) return false;
+    stmt.loop.last = parseExpression(0);
+    if (!stmt.loop.last) return false;
+    if (!expect(panc::TokenType::K_LOOP, "Expected 'loop' after loop bounds")) return false;
+
+    // Loops stay off the block stack: a failed loop is skipped by the
+    // enclosing procedure's recovery, which passes over "end loop".
+    if (loopDepth == panc::MAX_STACK_DEPTH)
+    {
+        addError("Loops nested too deeply", start.offset);
+        return false;
+    }
+    ++loopDepth;
+    panc::Stmt** tail{ &stmt.loop.body };
+    while (!atEnd() && peek().type != panc::TokenType::K_END)
+    {
+        panc::Stmt* const inner{ parseStatement() };
+        if (!inner)
+        {
+            --loopDepth;
+            return false;
+        }
+        *tail = inner;
+        tail = &inner->next;
+    }
+    --loopDepth;
+    if (!stmt.loop.body)
+    {
+        addError("Expected at least one statement in loop body", peek().offset);
+        return false;
+    }
+    if (peek().type != panc::TokenType::K_END || peek(1).type != panc::TokenType::K_LOOP)
+    {
+        addError("Missing 'end loop'", start.offset);
+        return false;
+    }
+    consume();
+    consume();
+    return true;
+}
+
+// destroy_stmt ::= "destroy" (type | identifier)    leave_stmt ::= "leave" identifier "from" type
+// "destroy <type>" discards the top of that value stack. The other two forms
+// are sugar: "destroy x" is "x <- 0", and "leave x from t" is "x <- pop t".
+bool Parser::parseStackStatement(panc::Stmt& stmt)
+{
+    panc::Token const start{ consume() };
+    panc::Token const name{ peek() };
+    if (!expect(panc::TokenType::IDENTIFIER, "Expected a type or variable name")) return false;
+    if (start.type == panc::TokenType::K_DESTROY && isTypeName(name))
+    {
+        stmt.kind = panc::StmtKind::DESTROY;
+        stmt.destroy.type_idx = intern(name.value, name.offset);
+        match(panc::TokenType::SEMICOLON);
+        return true;
+    }
+
+    panc::Expr* const target{ makeExpr(name.offset) };
+    panc::Expr* const value{ makeExpr(name.offset) };
+    if (!target || !value) return false;
+    stmt.kind = panc::StmtKind::ASSIGN;
+    stmt.assign.target = panc::Expr::createVariable(intern(name.value, name.offset), target);
+    if (start.type == panc::TokenType::K_DESTROY)
+        stmt.assign.value = panc::Expr::createLiteral(0, value);
+    else
+    {
+        if (!expect(panc::TokenType::K_FROM, "Expected 'from' after variable")) return false;
+        panc::Token const type{ peek() };
+        if (!isTypeName(type))
+        {
+            addError("Expected 'integer' or 'float' after 'from'", type.offset);
+            return false;
+        }
+        consume();
+        stmt.assign.value = panc::Expr::createPop(intern(type.value, type.offset), value);
+    }
+    match(panc::TokenType::SEMICOLON);
+    return true;
+}
+
+// delete_stmt ::= "delete" expression    pin_stmt ::= "pin" expression
+// Both become calls of the builtin of that name on a handle.
+bool Parser::parseHeapStatement(panc::Stmt& stmt)
+{
+    panc::Token const start{ consume() };
+    panc::Expr* const handle{ parseExpression(0) };
+    if (!handle) return false;
+    panc::Expr* const node{ makeExpr(start.offset, panc::Expr::funcCallSize(1)) };
+    if (!node) return false;
+    uint32_t const builtin{ intern(start.type == panc::TokenType::K_DELETE ? "delete" : "pin", start.offset) };
+    stmt.kind = panc::StmtKind::CALL;
+    stmt.call.expr = panc::Expr::createFuncCall(builtin, &handle, 1, node);
+    match(panc::TokenType::SEMICOLON);
+    return true;
+}
+
+// Precedence climbing over left-associative binary operators, loosest first:
+// "=", then "<" ">", then "+" "-", then "*" "/", then unary "-".
+panc::Expr* Parser::parseExpression(int minPower)
+{
+    if (++expressionDepth > panc::MAX_STACK_DEPTH)
+    {
+        addError("Expression nested too deeply", peek().offset);
+        --expressionDepth;
+        return nullptr;
+    }
+    // A left-associative chain grows in this loop rather than by recursion, so
+    // the tree's height is bounded separately from the parser's own depth.
+    panc::Expr* lhs{ parsePrefix() };
+    Infix infix{};
+    while (lhs && lhs->height <= panc::MAX_STACK_DEPTH && infixOf(peek().type, infix) && infix.power > minPower)
+    {
+        panc::Token const op{ consume() };
+        panc::Expr* const rhs{ parseExpression(infix.power) };
+        panc::Expr* const node{ rhs ? makeExpr(op.offset) : nullptr };
+        lhs = node ? panc::Expr::createBinary(infix.op, lhs, rhs, node) : nullptr;
+    }
+    if (lhs && lhs->height > panc::MAX_STACK_DEPTH)
+    {
+        addError("Expression nested too deeply", peek().offset);
+        lhs = nullptr;
+    }
+    --expressionDepth;
+    return lhs;
+}
+
+// prefix ::= literal | identifier ["(" [argument_list] ")"] | "-" prefix | "(" expression ")" | "pop" type | new_expr
+panc::Expr* Parser::parsePrefix()
 {
-    while (!atEnd() && !match(panc::TokenType::K_DO)) consume();
-    int depth{ 1 };
-    while (!atEnd() && depth > 0)
+    panc::Token const t{ peek() };
+    switch (t.type)
+    {
+    case panc::TokenType::NUMBER:
+    case panc::TokenType::STRING:
+        return parseLiteral();
+    case panc::TokenType::IDENTIFIER:
+        if (ci_equal(t.value, "true") || ci_equal(t.value, "false")) return parseLiteral();
+        consume();
+        return parseNamed(t);
+    case panc::TokenType::MINUS:
+    {
+        consume();
+        panc::Expr* const operand{ parseExpression(PREFIX_POWER) };
+        panc::Expr* const node{ operand ? makeExpr(t.offset) : nullptr };
+        return node ? panc::Expr::createUnary(panc::UnaryOp::NEG, operand, node) : nullptr;
+    }
+    case panc::TokenType::LPAREN:
     {
-        if (peek().type == panc::TokenType::K_DO) depth++;
-        else if (peek().type == panc::TokenType::K_END)
+        consume();
+        panc::Expr* const inner{ parseExpression(0) };
+        if (!inner || !expect(panc::TokenType::RPAREN, "Expected ')'")) return nullptr;
+        return inner;
+    }
+    case panc::TokenType::K_POP:
+    {
+        consume();
+        panc::Token const type{ peek() };
+        if (!isTypeName(type))
         {
-            panc::Token const& next{ (cursor + 1 < count) ? tokens[cursor + 1] : tokens[cursor] };
-            if (next.type == panc::TokenType::K_PROCEDURE || next.type == panc::TokenType::K_FUNCTION)
+            addError("Expected 'integer' or 'float' after 'pop'", type.offset);
+            return nullptr;
+        }
+        consume();
+        panc::Expr* const node{ makeExpr(t.offset) };
+        return node ? panc::Expr::createPop(intern(type.value, type.offset), node) : nullptr;
+    }
+    case panc::TokenType::K_NEW:
+        return parseNew();
+    default:
+        addError("Expected expression", t.offset);
+        return nullptr;
+    }
+}
+
+// new_expr ::= "new" type ["(" expression "..." expression ")"]
+// A call of the builtin "new" with the first and last cell index; without
+// bounds the block is the single cell 0.
+panc::Expr* Parser::parseNew()
+{
+    panc::Token const start{ consume() };
+    panc::Token const type{ peek() };
+    if (!isTypeName(type))
+    {
+        addError("Expected a type after 'new'", type.offset);
+        return nullptr;
+    }
+    consume();
+    if (!ci_equal(type.value, "integer"))
+    {
+        addError("Only integer cells can be allocated", type.offset);
+        return nullptr;
+    }
+
+    panc::Expr* bounds[2]{};
+    if (match(panc::TokenType::LPAREN))
+    {
+        bounds[0] = parseExpression(0);
+        if (!bounds[0]) return nullptr;
+        for (int i{ 0 }; i < 3; ++i)
+            if (!expect(panc::TokenType::DOT, "Expected '...' between allocation bounds")) return nullptr;
+        bounds[1] = parseExpression(0);
+        if (!bounds[1] || !expect(panc::TokenType::RPAREN, "Expected ')' after allocation bounds")) return nullptr;
+    }
+    else
+        for (panc::Expr*& bound : bounds)
+        {
+            panc::Expr* const zero{ makeExpr(start.offset) };
+            if (!zero) return nullptr;
+            bound = panc::Expr::createLiteral(0, zero);
+        }
+
+    panc::Expr* const node{ makeExpr(start.offset, panc::Expr::funcCallSize(2)) };
+    return node ? panc::Expr::createFuncCall(intern("new", start.offset), bounds, 2, node) : nullptr;
+}
+
+// identifier ["(" [argument_list] ")"]    argument_list ::= expression ("," expression)*
+panc::Expr* Parser::parseNamed(panc::Token const& name)
+{
+    if (peek().type != panc::TokenType::LPAREN)
+    {
+        panc::Expr* const expr{ makeExpr(name.offset) };
+        return expr ? panc::Expr::createVariable(intern(name.value, name.offset), expr) : nullptr;
+    }
+    consume();
+
+    // Arguments of nested calls stack up in pendingArgs until their node is sized.
+    std::size_t const base{ pendingArgs.size() };
+    if (!match(panc::TokenType::RPAREN))
+    {
+        do
+        {
+            panc::Expr* const arg{ parseExpression(0) };
+            if (!arg)
             {
-                depth--;
-                consume();
-                consume();
-                continue;
+                pendingArgs.resize(base);
+                return nullptr;
             }
+            pendingArgs.push_back(arg);
+        } while (match(panc::TokenType::COMMA));
+        if (!expect(panc::TokenType::RPAREN, "Expected ')' after arguments"))
+        {
+            pendingArgs.resize(base);
+            return nullptr;
         }
-        if (depth > 0)
-            if (panc::Token const t{ consume() }; t.type == panc::TokenType::IDENTIFIER && t.value == "print_line")
-                if (match(panc::TokenType::LPAREN) && peek().type == panc::TokenType::STRING)
-                {
-                    std::cout << consume().value << '\n';
-                    match(panc::TokenType::RPAREN);
-                }
     }
+
+    uint32_t const count{ static_cast<uint32_t>(pendingArgs.size() - base) };
+    panc::Expr* const expr{ makeExpr(name.offset, panc::Expr::funcCallSize(count)) };
+    panc::Expr* const call{ expr ? panc::Expr::createFuncCall(intern(name.value, name.offset), pendingArgs.data() + base, count, expr) : nullptr };
+    pendingArgs.resize(base);
+    return call;
 }
 
-bool Parser::validateStructure() const
+// literal ::= STRING | NUMBER | BOOLEAN
+panc::Expr* Parser::parseLiteral()
 {
-    parser::parseStack.clear();
-    parser::syntaxErrors.clear();
-    std::size_t i{ 0 };
-    while (i < count)
+    panc::Token const t{ consume() };
+    panc::Expr* const expr{ makeExpr(t.offset) };
+    if (!expr) return nullptr;
+    if (t.type == panc::TokenType::STRING)
+        return panc::Expr::createString(intern(t.value, t.offset), expr);
+    if (t.type == panc::TokenType::NUMBER)
     {
-        panc::Token const& tok{ tokens[i] };
-        if (tok.type == panc::TokenType::K_CLASS || tok.type == panc::TokenType::K_FUNCTION || tok.type == panc::TokenType::K_PROCEDURE)
+        int32_t value{};
+        auto const [end, ec]{ std::from_chars(t.value.data(), t.value.data() + t.value.size(), value) };
+        if (ec != std::errc{})
         {
-            std::string_view name{ (i + 1 < count) ? tokens[i + 1].value : "unknown" };
-            parser::parseStack.push_back({ tok.type, name, tok.position });
-            i++;
+            addError("Number literal out of range", t.offset);
+            return nullptr;
         }
-        else if (tok.type == panc::TokenType::K_END)
+        return panc::Expr::createLiteral(value, expr);
+    }
+    return panc::Expr::createLiteral(ci_equal(t.value, "true") ? 1 : 0, expr);
+}
+
+// class_decl ::= "class" identifier ... "end" "class"
+panc::Class* Parser::parseClassHeader(panc::Token const& start)
+{
+    panc::Token const name{ peek() };
+    if (name.type != panc::TokenType::IDENTIFIER)
+    {
+        addError("Expected class name", name.offset);
+        return nullptr;
+    }
+    consume();
+    panc::Class* const cls{ make<panc::Class>(start.offset) };
+    if (!cls) return nullptr;
+    cls->name_idx = intern(name.value, name.offset);
+    cls->offset = start.offset;
+    return cls;
+}
+
+// class_vars ::= type "{" (identifier ["<-" field_init])* "}"
+// Only integer variables, which take one cell, may be given a starting value.
+void Parser::parseClassVars()
+{
+    panc::Token const type{ consume() };
+    consume();
+    uint32_t const type_idx{ intern(type.value, type.offset) };
+    while (!outOfMemory && peek().type == panc::TokenType::IDENTIFIER)
+    {
+        panc::ClassVar* const var{ addClassVar(consume(), type_idx, 1, false) };
+        if (!match(panc::TokenType::ARROW)) continue;
+        if (!ci_equal(type.value, "integer"))
         {
-            if (parser::parseStack.empty()) { addError("Unexpected 'end'", tok.position); i++; continue; }
-            if ((i + 1 < count ? tokens[i + 1].type : panc::TokenType::UNKNOWN) == parser::parseStack.back().openKind) i += 2;
-            else { addError("Mismatched block closure", tok.position); i++; }
-            parser::parseStack.pop_back();
+            addError("Only integer class variables can be initialised", peek().offset);
+            return;
         }
-        else i++;
+        double value{};
+        if (!parseFieldInit(false, value)) return;
+        if (var) var->init = static_cast<int32_t>(value);
     }
-    while (!parser::parseStack.empty()) { addError("Missing 'end' for block", parser::parseStack.back().position); parser::parseStack.pop_back(); }
-    if (!parser::syntaxErrors.empty())
+    expect(panc::TokenType::RBRACE, "Expected '}' after variable list");
+}
+
+// manual_block ::= "manual" "do" manual_decl* "end" "manual"
+// manual_decl ::= identifier ":" [type | structure ["aos" | "soa"]] ["pinned"] "allocate"
+//                 ("sizeof" (type | structure) | "cells" NUMBER)
+// A declaration that fails is skipped up to the next one.
+void Parser::parseManual()
+{
+    panc::Token const start{ consume() };
+    if (!currentClass) addError("Manual block outside a class", start.offset);
+    if (!expect(panc::TokenType::K_DO, "Expected 'do' after 'manual'")) return;
+    while (!outOfMemory && !atEnd() && peek().type != panc::TokenType::K_END)
+        if (!parseManualDecl())
+            while (!atEnd() && peek().type != panc::TokenType::K_END
+                && !(peek().type == panc::TokenType::IDENTIFIER && peek(1).type == panc::TokenType::COLON))
+                consume();
+    if (peek().type != panc::TokenType::K_END || peek(1).type != panc::TokenType::K_MANUAL)
+    {
+        addError("Missing 'end manual'", start.offset);
+        return;
+    }
+    consume();
+    consume();
+}
+
+// "sizeof t" allocates the 32-bit cells a t needs; the type defaults to integer.
+// A structure array is stored element by element unless declared "soa".
+bool Parser::parseManualDecl()
+{
+    panc::Token const name{ peek() };
+    if (!expect(panc::TokenType::IDENTIFIER, "Expected manual variable name")) return false;
+    if (!expect(panc::TokenType::COLON, "Expected ':' after manual variable name")) return false;
+    panc::Token const type{ peek() };
+    panc::Structure const* structure{ nullptr };
+    bool soa{ false };
+    uint32_t const type_idx{ intern(type.type == panc::TokenType::IDENTIFIER ? type.value : "integer", type.offset) };
+    if (isTypeName(type)) consume();
+    else if (type.type == panc::TokenType::IDENTIFIER)
+    {
+        consume();
+        structure = findStructure(type_idx);
+        if (!structure)
+        {
+            addError("Unknown structure", type.offset);
+            return false;
+        }
+        if (peek().type == panc::TokenType::IDENTIFIER && (ci_equal(peek().value, "aos") || ci_equal(peek().value, "soa")))
+            soa = ci_equal(consume().value, "soa");
+    }
+    bool const pinned{ match(panc::TokenType::K_PINNED) };
+    if (!expect(panc::TokenType::K_ALLOCATE, "Expected 'allocate'")) return false;
+
+    uint32_t cells{};
+    uint32_t count{ 1 };
+    if (match(panc::TokenType::K_SIZEOF))
+    {
+        panc::Token const sized{ peek() };
+        if (structure ? !(sized.type == panc::TokenType::IDENTIFIER && intern(sized.value, sized.offset) == structure->name_idx) : !isTypeName(sized))
+        {
+            addError(structure ? "Expected the declared structure after 'sizeof'" : "Expected 'integer' or 'float' after 'sizeof'", sized.offset);
+            return false;
+        }
+        consume();
+        cells = ci_equal(sized.value, "float") ? sizeof(double) / sizeof(int32_t) : 1;
+    }
+    else if (match(panc::TokenType::K_CELLS))
+    {
+        panc::Token const counted{ peek() };
+        if (!expect(panc::TokenType::NUMBER, "Expected a cell count after 'cells'")) return false;
+        auto const [end, ec]{ std::from_chars(counted.value.data(), counted.value.data() + counted.value.size(), count) };
+        if (ec != std::errc{} || count == 0 || count > MAX_MANUAL_CELLS)
+        {
+            addError("Cell count out of range", counted.offset);
+            return false;
+        }
+        cells = count;
+    }
+    else
     {
-        for (auto const& e : parser::syntaxErrors)
-            std::cerr << "Syntax Error: " << e.message << " at Line " << e.errorLocation.line << '\n';
+        addError("Expected 'sizeof' or 'cells' after 'allocate'", peek().offset);
         return false;
     }
+    if (structure)
+    {
+        // For a structure, "cells N" counts elements rather than cells. Struct
+        // of arrays never needs more room than the padded elements would.
+        if (uint64_t{ count } * structure->size / panc::CELL_BYTES > MAX_MANUAL_CELLS)
+        {
+            addError("Structure array too large", name.offset);
+            return false;
+        }
+        cells = panc::arrayBytes(*structure, count, soa) / panc::CELL_BYTES;
+    }
+    if (currentClass)
+        if (panc::ClassVar* const var{ addClassVar(name, type_idx, cells, pinned) })
+        {
+            var->structure = structure;
+            var->count = count;
+            var->soa = soa;
+        }
+    match(panc::TokenType::SEMICOLON);
     return true;
 }
 
-void Parser::addError(char const* msg, panc::SourceLocation loc)
+// structure_decl ::= "structure" identifier (type "{" (identifier ["<-" field_init])* "}")* "end" "structure"
+// Structures declared outside a class may be used by any class after them.
+void Parser::parseStructure()
+{
+    panc::Token const start{ consume() };
+    panc::Token const name{ peek() };
+    panc::Arena::Scope nodes{ arena };
+    panc::Structure* const s{ make<panc::Structure>(start.offset) };
+    if (!s) return;
+    s->offset = start.offset;
+    bool ok{ expect(panc::TokenType::IDENTIFIER, "Expected structure name") };
+    if (ok) s->name_idx = intern(name.value, name.offset);
+    panc::StructField** tail{ &s->fields };
+
+    while (ok && !outOfMemory && !atEnd() && !isStructureBoundary(peek().type))
+    {
+        panc::Token const type{ peek() };
+        if (!isTypeName(type))
+        {
+            addError("Expected 'integer' or 'float' group in structure", type.offset);
+            ok = false;
+            break;
+        }
+        consume();
+        bool const isFloat{ ci_equal(type.value, "float") };
+        uint32_t const type_idx{ intern(type.value, type.offset) };
+        if (!(ok = expect(panc::TokenType::LBRACE, "Expected '{' after field type"))) break;
+        while (ok && !outOfMemory && peek().type == panc::TokenType::IDENTIFIER)
+        {
+            panc::Token const fieldName{ consume() };
+            uint32_t const name_idx{ intern(fieldName.value, fieldName.offset) };
+            // A name may appear once per type, as struct.k has x in both groups.
+            for (panc::StructField const* f{ s->fields }; f; f = f->next)
+                if (f->name_idx == name_idx && f->type_idx == type_idx)
+                {
+                    addError("Duplicate structure field", fieldName.offset);
+                    ok = false;
+                }
+            panc::StructField* const field{ make<panc::StructField>(fieldName.offset) };
+            if (!field) return;
+            field->name_idx = name_idx;
+            field->type_idx = type_idx;
+            field->size = isFloat ? sizeof(double) : sizeof(int32_t);
+            if (match(panc::TokenType::ARROW))
+            {
+                field->has_init = true;
+                ok = ok && parseFieldInit(isFloat, field->init);
+            }
+            *tail = field;
+            tail = &field->next;
+            ++s->field_count;
+        }
+        ok = ok && expect(panc::TokenType::RBRACE, "Expected '}' after structure fields");
+    }
+    if (ok && s->field_count == 0)
+    {
+        addError("Expected at least one field in structure", start.offset);
+        ok = false;
+    }
+
+    // Like synchronize(): a closer of some other block, or the start of a new
+    // one, ends the structure and is left for the caller, so the rest of the
+    // file is still parsed. A structure whose fields were fine is kept.
+    while (!atEnd() && !isStructureBoundary(peek().type)) consume();
+    if (peek().type == panc::TokenType::K_END && peek(1).type == panc::TokenType::K_STRUCTURE)
+    {
+        consume();
+        consume();
+    }
+    else addError("Missing 'end structure'", atEnd() ? start.offset : peek().offset);
+    if (!ok) return;
+
+    panc::layOut(*s);
+    panc::Structure** list{ currentClass ? &currentClass->structures : &fileStructures };
+    for (; *list; list = &(*list)->next)
+        if ((*list)->name_idx == s->name_idx)
+        {
+            addError("Duplicate structure", name.offset);
+            return;
+        }
+    *list = s;
+    nodes.commit();
+}
+
+// field_init ::= ["-"] NUMBER ["." NUMBER]; the fraction only for float fields.
+bool Parser::parseFieldInit(bool isFloat, double& value)
+{
+    panc::Token const first{ peek() };
+    bool const negative{ match(panc::TokenType::MINUS) };
+    panc::Token const whole{ peek() };
+    if (!expect(panc::TokenType::NUMBER, "Expected a number after '<-'")) return false;
+    char const* end{ whole.value.data() + whole.value.size() };
+    if (isFloat && peek().type == panc::TokenType::DOT && peek().offset == whole.offset + whole.value.size()
+        && peek(1).type == panc::TokenType::NUMBER && peek(1).offset == peek().offset + 1)
+    {
+        consume();
+        panc::Token const fraction{ consume() };
+        end = fraction.value.data() + fraction.value.size();
+    }
+    auto const [last, ec]{ std::from_chars(whole.value.data(), end, value) };
+    if (negative) value = -value;
+    if (ec != std::errc{} || last != end || (!isFloat && (value < INT32_MIN || value > INT32_MAX)))
+    {
+        addError("Field initialiser out of range", first.offset);
+        return false;
+    }
+    return true;
+}
+
+panc::Structure const* Parser::findStructure(uint32_t name_idx) const
+{
+    for (panc::Structure const* list : { currentClass ? currentClass->structures : nullptr, fileStructures })
+        for (panc::Structure const* s{ list }; s; s = s->next)
+            if (s->name_idx == name_idx) return s;
+    return nullptr;
+}
+
+panc::ClassVar* Parser::addClassVar(panc::Token const& name, uint32_t type_idx, uint32_t cells, bool pinned)
+{
+    uint32_t const name_idx{ intern(name.value, name.offset) };
+    panc::ClassVar** tail{ &currentClass->vars };
+    for (; *tail; tail = &(*tail)->next)
+        if ((*tail)->name_idx == name_idx)
+        {
+            addError("Duplicate class variable", name.offset);
+            return nullptr;
+        }
+    panc::ClassVar* const var{ make<panc::ClassVar>(name.offset) };
+    if (!var) return nullptr;
+    var->name_idx = name_idx;
+    var->type_idx = type_idx;
+    var->offset = name.offset;
+    var->cells = cells;
+    var->pinned = pinned;
+    *tail = var;
+    ++currentClass->var_count;
+    currentClass->cell_count += cells;
+    return var;
+}
+
+// lowlevel_block ::= "lowlevel" "do" forth_block* "end" ["lowlevel"]
+// Anything other than a forth block inside (an @include line) is skipped.
+void Parser::parseLowLevel()
+{
+    panc::Token const start{ consume() };
+    if (!expect(panc::TokenType::K_DO, "Expected 'do' after 'lowlevel'")) return;
+    panc::ForthBlock** tail{ currentClass ? &currentClass->forth : nullptr };
+    while (tail && *tail) tail = &(*tail)->next;
+
+    while (!outOfMemory && !atEnd() && peek().type != panc::TokenType::K_END)
+    {
+        if (peek().type != panc::TokenType::K_FORTH)
+        {
+            consume();
+            continue;
+        }
+        if (!currentClass) addError("Forth block outside a class", peek().offset);
+        panc::ForthBlock* const block{ parseForth() };
+        if (block && tail)
+        {
+            *tail = block;
+            tail = &block->next;
+        }
+    }
+    if (!match(panc::TokenType::K_END))
+    {
+        addError("Missing 'end' for lowlevel block", start.offset);
+        return;
+    }
+    match(panc::TokenType::K_LOWLEVEL);
+}
+
+// forth_block ::= "forth" word* "end" "forth"
+// word ::= NUMBER | "-" NUMBER | identifier ["." identifier] | "+" | "-" | "*" | "/" | "=" | "<" | ">" | "!" | "@" | "."
+panc::ForthBlock* Parser::parseForth()
+{
+    panc::Token const start{ consume() };
+    pendingWords.clear();
+    while (!atEnd() && peek().type != panc::TokenType::K_END)
+    {
+        panc::Token const t{ consume() };
+        panc::ForthWord word{ panc::ForthWordKind::LITERAL, t.offset, 0 };
+        switch (t.type)
+        {
+        case panc::TokenType::NUMBER:
+        case panc::TokenType::MINUS:
+        {
+            bool const negative{ t.type == panc::TokenType::MINUS };
+            if (negative && !(peek().type == panc::TokenType::NUMBER && peek().offset == t.offset + 1))
+            {
+                word.kind = panc::ForthWordKind::SUB;
+                break;
+            }
+            std::string_view const digits{ negative ? consume().value : t.value };
+            int64_t value{};
+            auto const [end, ec]{ std::from_chars(digits.data(), digits.data() + digits.size(), value) };
+            if (negative) value = -value;
+            if (ec != std::errc{} || value < INT32_MIN || value > INT32_MAX)
+            {
+                addError("Number literal out of range", t.offset);
+                continue;
+            }
+            word.value = static_cast<int32_t>(value);
+            break;
+        }
+        case panc::TokenType::IDENTIFIER:
+        {
+            // "P.x" or "P.integer.x", written without spaces, is one word naming a
+            // structure field, the second picking it from one type's group.
+            std::string_view text{ t.value };
+            for (int part{ 0 }; part < 2 && peek().type == panc::TokenType::DOT && peek().offset == t.offset + text.size()
+                && peek(1).type == panc::TokenType::IDENTIFIER && peek(1).offset == peek().offset + 1; ++part)
+            {
+                consume();
+                text = { t.value.data(), text.size() + 1 + consume().value.size() };
+            }
+            word.kind = panc::ForthWordKind::NAME;
+            word.value = static_cast<int32_t>(intern(text, t.offset));
+            break;
+        }
+        case panc::TokenType::PLUS: word.kind = panc::ForthWordKind::ADD; break;
+        case panc::TokenType::STAR: word.kind = panc::ForthWordKind::MUL; break;
+        case panc::TokenType::SLASH: word.kind = panc::ForthWordKind::DIV; break;
+        case panc::TokenType::EQUAL: word.kind = panc::ForthWordKind::EQ; break;
+        case panc::TokenType::LESS: word.kind = panc::ForthWordKind::LT; break;
+        case panc::TokenType::GREATER: word.kind = panc::ForthWordKind::GT; break;
+        case panc::TokenType::BANG: word.kind = panc::ForthWordKind::STORE; break;
+        case panc::TokenType::AT: word.kind = panc::ForthWordKind::FETCH; break;
+        case panc::TokenType::DOT: word.kind = panc::ForthWordKind::PRINT; break;
+        default:
+            addError("Unexpected token in forth block", t.offset);
+            continue;
+        }
+        pendingWords.push_back(word);
+    }
+    if (peek().type != panc::TokenType::K_END || peek(1).type != panc::TokenType::K_FORTH)
+    {
+        addError("Missing 'end forth'", start.offset);
+        return nullptr;
+    }
+    consume();
+    consume();
+
+    panc::ForthBlock* const block{ make<panc::ForthBlock>(start.offset) };
+    if (!block) return nullptr;
+    block->offset = start.offset;
+    block->word_count = static_cast<uint32_t>(pendingWords.size());
+    if (!pendingWords.empty())
+    {
+        block->words = static_cast<panc::ForthWord*>(allocate(pendingWords.size() * sizeof(panc::ForthWord), alignof(panc::ForthWord), start.offset));
+        if (!block->words) return nullptr;
+        std::memcpy(block->words, pendingWords.data(), pendingWords.size() * sizeof(panc::ForthWord));
+    }
+    return block;
+}
+
+bool Parser::isTypeName(panc::Token const& t)
+{
+    return t.type == panc::TokenType::IDENTIFIER && (ci_equal(t.value, "integer") || ci_equal(t.value, "float"));
+}
+
+template<typename T>
+T* Parser::make(std::uint32_t offset)
+{
+    T* const node{ arena.allocateTrivial<T>() };
+    if (!node && !outOfMemory)
+    {
+        addError("Out of memory for syntax tree", offset);
+        outOfMemory = true;
+    }
+    return node;
+}
+
+panc::Expr* Parser::makeExpr(std::uint32_t offset, std::size_t size)
+{
+    return static_cast<panc::Expr*>(allocate(size, alignof(panc::Expr), offset));
+}
+
+void* Parser::allocate(std::size_t size, std::size_t align, std::uint32_t offset)
+{
+    void* const memory{ arena.allocateBytes(size, align) };
+    if (!memory && !outOfMemory)
+    {
+        addError("Out of memory for syntax tree", offset);
+        outOfMemory = true;
+    }
+    return memory;
+}
+
+uint32_t Parser::intern(std::string_view text, std::uint32_t offset)
+{
+    uint32_t const idx{ strings.add(text.data(), static_cast<uint32_t>(text.size())) };
+    if (idx == panc::StringTable::NONE && !outOfMemory)
+    {
+        addError("Out of memory for string table", offset);
+        outOfMemory = true;
+    }
+    return idx;
+}
+
+void Parser::openBlock(panc::TokenType kind, std::uint32_t offset)
+{
+    if (parseStack.size() == panc::MAX_STACK_DEPTH)
+        addError("Blocks nested too deeply", offset);
+    parseStack.push_back({ kind, peek().value, offset });
+}
+
+// "end <kind>": closes the innermost open block of that kind, reporting any blocks
+// left open above it. A closer that matches nothing is reported and skipped.
+void Parser::closeBlock()
+{
+    panc::Token const end{ consume() };
+    panc::TokenType const kind{ peek().type };
+    std::size_t depth{ parseStack.size() };
+    while (depth > 0 && parseStack[depth - 1].openKind != kind)
+        --depth;
+    if (depth == 0)
+    {
+        addError(parseStack.empty() ? "Unexpected 'end'" : "Mismatched block closure", end.offset);
+        if (isBlockKind(kind)) consume();
+        return;
+    }
+    consume();
+    closeBlocksTo(depth);
+    parseStack.pop_back();
+}
+
+void Parser::closeBlocksTo(std::size_t depth)
+{
+    while (parseStack.size() > depth)
+    {
+        addError("Missing 'end' for block", parseStack.back().offset);
+        parseStack.pop_back();
+    }
+}
+
+bool Parser::isOpen(panc::TokenType kind, std::size_t below) const
+{
+    for (std::size_t i{ 0 }; i < below && i < parseStack.size(); ++i)
+        if (parseStack[i].openKind == kind)
+            return true;
+    return false;
+}
+
+bool Parser::isBlockKind(panc::TokenType kind)
+{
+    return kind == panc::TokenType::K_CLASS || kind == panc::TokenType::K_FUNCTION || kind == panc::TokenType::K_PROCEDURE;
+}
+
+// Tokens that cannot appear inside a structure: any "end", or the start of
+// another block.
+bool Parser::isStructureBoundary(panc::TokenType t)
+{
+    return t == panc::TokenType::K_END || t == panc::TokenType::K_STRUCTURE || t == panc::TokenType::K_MANUAL
+        || t == panc::TokenType::K_LOWLEVEL || isBlockKind(t);
+}
+
+// Panic-mode recovery for a procedure that failed to parse: skip to its
+// "end procedure", or stop at the first token that closes an enclosing block or
+// opens a new one, leaving that token for the caller.
+void Parser::synchronize(std::size_t depth)
+{
+    while (!outOfMemory && !atEnd())
+    {
+        panc::TokenType const t{ peek().type };
+        if (t == panc::TokenType::K_END)
+        {
+            panc::TokenType const kind{ peek(1).type };
+            if (kind == panc::TokenType::K_PROCEDURE)
+            {
+                consume();
+                consume();
+                closeBlocksTo(depth);
+                parseStack.pop_back();
+                return;
+            }
+            if (isOpen(kind, depth - 1))
+                return;
+            // A block closer that matches nothing is reported as closeBlock() would,
+            // so its kind is not mistaken for a new block's opener.
+            panc::Token const end{ consume() };
+            if (isBlockKind(kind))
+            {
+                addError("Mismatched block closure", end.offset);
+                consume();
+            }
+            continue;
+        }
+        if (isBlockKind(t))
+        {
+            closeBlocksTo(depth - 1);
+            return;
+        }
+        consume();
+    }
+}
+
+bool Parser::reportErrors() const
+{
+    if (syntaxErrors.empty()) return true;
+    for (auto const& e : syntaxErrors)
+        std::cerr << "Syntax Error: " << e.message << " at Line " << e.errorLocation.line << '\n';
+    return false;
+}
+
+void Parser::addError(char const* msg, std::uint32_t offset)
 {
     panc::SyntaxError e{};
     panc::strcpy(e.message, sizeof(e.message), msg);
-    e.errorLocation = loc;
-    parser::syntaxErrors.push_back(e);
-}
\ No newline at end of file
+    e.errorLocation = lines.locate(offset);
+    syntaxErrors.push_back(e);
+}
@@ -2,30 +2,93 @@
 #define PANCPARSER_HPP
 
 #include "panctoken.hpp"
+#include "panccursor.hpp"
+#include "pancsource.hpp"
 #include "pancutil.hpp"
-#include "pancvar.hpp"
+#include "panccontext.hpp"
+#include "pancarray.hpp"
 #include "pancarena.hpp"
 #include "pancexpr.hpp"
+#include "pancast.hpp"
 #include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
 
+// Recursive-descent parser for pancakesgrammer.txt. Nodes are placed in the
+// context's arena, names in its string table and errors in its syntaxErrors;
+// the returned tree stays valid for as long as the context does. Block balance
+// is checked during the same pass, and a procedure with errors is skipped up to
+// its "end procedure" so the rest of the file is still parsed and checked.
 class Parser
 {
-    panc::Token* tokens;
-    std::size_t count;
-    std::size_t cursor{ 0 };
+    TokenCursor& tokens;
+    panc::LineTable const& lines;
+    panc::Arena& arena;
+    panc::StringTable& strings;
+    panc::array<panc::SyntaxError, panc::MAX_SYNTAX_ERRORS>& syntaxErrors;
+    panc::array<panc::BlockInfo, panc::MAX_STACK_DEPTH> parseStack{};
+    bool outOfMemory{ false };
+    std::size_t expressionDepth{ 0 };
+    std::size_t loopDepth{ 0 };
+    std::vector<panc::Expr*> pendingArgs{};
+    std::vector<panc::ForthWord> pendingWords{};
+    panc::Class* currentClass{ nullptr };
+    panc::Structure* fileStructures{ nullptr };
 
 public:
-    Parser(panc::Token* t, std::size_t c);
-    bool run();
+    Parser(TokenCursor& cursor, panc::CompilationContext& context);
+    panc::Program* parse();
+    bool hasErrors() const;
 
 private:
-    panc::Token const& peek() const;
-    bool atEnd() const;
+    panc::Token const& peek(std::size_t ahead = 0);
+    bool atEnd();
     panc::Token consume();
     bool match(panc::TokenType t);
-    void executeMain();
-    bool validateStructure() const;
-    static void addError(char const* msg, panc::SourceLocation loc);
+    bool expect(panc::TokenType t, char const* msg);
+
+    panc::Procedure* parseProcedure();
+    panc::Procedure* parseProcedureRest(panc::Token const& start);
+    panc::Param* parseParams(uint32_t& count);
+    bool parseLocals(panc::Procedure& proc);
+    panc::Stmt* parseStatement();
+    bool parseFor(panc::Stmt& stmt);
+    bool parseStackStatement(panc::Stmt& stmt);
+    bool parseHeapStatement(panc::Stmt& stmt);
+    panc::Expr* parseExpression(int minPower);
+    panc::Expr* parsePrefix();
+    panc::Expr* parseNew();
+    panc::Expr* parseNamed(panc::Token const& name);
+    panc::Expr* parseLiteral();
+    static bool isTypeName(panc::Token const& t);
+
+    panc::Class* parseClassHeader(panc::Token const& start);
+    void parseClassVars();
+    void parseManual();
+    bool parseManualDecl();
+    panc::ClassVar* addClassVar(panc::Token const& name, uint32_t type_idx, uint32_t cells, bool pinned);
+    void parseStructure();
+    bool parseFieldInit(bool isFloat, double& value);
+    panc::Structure const* findStructure(uint32_t name_idx) const;
+    void parseLowLevel();
+    panc::ForthBlock* parseForth();
+
+    template<typename T>
+    T* make(std::uint32_t offset);
+    panc::Expr* makeExpr(std::uint32_t offset, std::size_t size = sizeof(panc::Expr));
+    void* allocate(std::size_t size, std::size_t align, std::uint32_t offset);
+    uint32_t intern(std::string_view text, std::uint32_t offset);
+
+    void openBlock(panc::TokenType kind, std::uint32_t offset);
+    void closeBlock();
+    void closeBlocksTo(std::size_t depth);
+    bool isOpen(panc::TokenType kind, std::size_t below) const;
+    static bool isBlockKind(panc::TokenType kind);
+    static bool isStructureBoundary(panc::TokenType t);
+    void synchronize(std::size_t depth);
+    bool reportErrors() const;
+    void addError(char const* msg, std::uint32_t offset);
 };
 
-#endif
\ No newline at end of file
+#endif
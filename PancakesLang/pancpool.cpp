@@ -0,0 +1,172 @@
+#include "pancpool.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+namespace panc
+{
+    Pool::~Pool()
+    {
+        while (large)
+        {
+            Large* const next{ large->next };
+            unmapPages(large, large->mapped);
+            large = next;
+        }
+    }
+
+    std::size_t Pool::classOf(std::size_t bytes)
+    {
+        std::size_t c{ 0 };
+        while ((MIN_BLOCK << c) < bytes) ++c;
+        return c;
+    }
+
+    void Pool::checkPoison(FreeBlock const* block, std::size_t size) const
+    {
+        unsigned char const* const bytes{ reinterpret_cast<unsigned char const*>(block) };
+        for (std::size_t i{ sizeof(FreeBlock) }; i < size; ++i)
+            if (bytes[i] != POISON)
+            {
+                std::cerr << "Runtime Error: memory written after it was deleted\n";
+                std::abort();
+            }
+    }
+
+    void* Pool::allocate(std::size_t bytes)
+    {
+        if (bytes > MAX_BLOCK)
+        {
+            if (bytes > SIZE_MAX - sizeof(Large)) return nullptr;
+            std::size_t const mapped{ sizeof(Large) + bytes };
+            void* const pages{ mapPages(mapped) };
+            if (!pages) return nullptr;
+            Large* const block{ new (pages) Large{ nullptr, large, mapped } };
+            if (large) large->prev = block;
+            large = block;
+            largeBytes += mapped;
+            return block + 1;
+        }
+
+        std::size_t const c{ classOf(bytes) };
+        std::size_t const size{ MIN_BLOCK << c };
+        if (FreeBlock* const block{ freeLists[c] })
+        {
+            freeLists[c] = block->next;
+            if constexpr (POISON_FREED) checkPoison(block, size);
+            return block;
+        }
+        return small.allocateBytes(size, MIN_BLOCK);
+    }
+
+    void Pool::release(void* block, std::size_t bytes)
+    {
+        if (!block) return;
+        if (bytes > MAX_BLOCK)
+        {
+            Large* const header{ static_cast<Large*>(block) - 1 };
+            if (header->prev) header->prev->next = header->next;
+            else large = header->next;
+            if (header->next) header->next->prev = header->prev;
+            largeBytes -= header->mapped;
+            unmapPages(header, header->mapped);
+            return;
+        }
+
+        std::size_t const c{ classOf(bytes) };
+        if constexpr (POISON_FREED) std::memset(block, POISON, MIN_BLOCK << c);
+        FreeBlock* const freed{ static_cast<FreeBlock*>(block) };
+        freed->next = freeLists[c];
+        freeLists[c] = freed;
+    }
+
+    char const* Heap::create(int32_t first, int32_t last, int32_t& handle)
+    {
+        if (last < first) return "empty allocation range";
+        int64_t const count{ int64_t{ last } - first + 1 };
+        if (count > MAX_CELLS) return "allocation too large";
+        if (freeSlots.empty() && blocks.size() == SLOT_MASK) return "too many live allocations";
+
+        std::size_t const bytes{ static_cast<std::size_t>(count) * sizeof(int32_t) };
+        int32_t* const cells{ static_cast<int32_t*>(pool.allocate(bytes)) };
+        if (!cells) return "out of memory";
+        std::memset(cells, 0, bytes);
+
+        uint32_t slot{};
+        if (freeSlots.empty())
+        {
+            slot = static_cast<uint32_t>(blocks.size());
+            blocks.push_back({});
+        }
+        else
+        {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        Block& block{ blocks[slot] };
+        block.cells = cells;
+        block.first = first;
+        block.count = static_cast<uint32_t>(count);
+        block.live = true;
+        block.pinned = false;
+        handle = static_cast<int32_t>(block.generation << SLOT_BITS | (slot + 1));
+        return nullptr;
+    }
+
+    char const* Heap::release(int32_t handle)
+    {
+        Block* const block{ find(handle) };
+        if (!block) return "delete of an invalid or deleted handle";
+        if (block->pinned) return "cannot delete a pinned allocation";
+        pool.release(block->cells, std::size_t{ block->count } * sizeof(int32_t));
+        block->cells = nullptr;
+        block->live = false;
+        block->generation = (block->generation + 1) & GENERATION_MASK;
+        freeSlots.push_back(static_cast<uint32_t>(block - blocks.data()));
+        return nullptr;
+    }
+
+    char const* Heap::pin(int32_t handle)
+    {
+        Block* const block{ find(handle) };
+        if (!block) return "pin of an invalid or deleted handle";
+        block->pinned = true;
+        return nullptr;
+    }
+
+    char const* Heap::load(int32_t handle, int32_t index, int32_t& value) const
+    {
+        Block const* const block{ find(handle) };
+        uint32_t offset{};
+        if (char const* const error{ cell(block, index, offset) }) return error;
+        value = block->cells[offset];
+        return nullptr;
+    }
+
+    char const* Heap::store(int32_t handle, int32_t index, int32_t value)
+    {
+        Block* const block{ find(handle) };
+        uint32_t offset{};
+        if (char const* const error{ cell(block, index, offset) }) return error;
+        block->cells[offset] = value;
+        return nullptr;
+    }
+
+    Heap::Block const* Heap::find(int32_t handle) const
+    {
+        if (handle <= 0) return nullptr;
+        uint32_t const bits{ static_cast<uint32_t>(handle) };
+        uint32_t const slot{ (bits & SLOT_MASK) - 1 };
+        if (slot >= blocks.size()) return nullptr;
+        Block const& block{ blocks[slot] };
+        return block.live && block.generation == bits >> SLOT_BITS ? &block : nullptr;
+    }
+
+    char const* Heap::cell(Block const* block, int32_t index, uint32_t& offset)
+    {
+        if (!block) return "use of an invalid or deleted handle";
+        offset = static_cast<uint32_t>(index) - static_cast<uint32_t>(block->first);
+        return offset < block->count ? nullptr : "index out of bounds";
+    }
+}
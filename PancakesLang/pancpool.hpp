@@ -0,0 +1,108 @@
+#ifndef PANCPOOL_HPP
+#define PANCPOOL_HPP
+
+#include "pancarena.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace panc
+{
+    // Debug builds, or any build defining PANC_POOL_POISON, fill released blocks
+    // with a pattern and check it when the block is handed out again, so a write
+    // through a dangling pointer is caught at the next allocation.
+#if defined(PANC_POOL_POISON) || !defined(NDEBUG)
+    constexpr bool POISON_FREED{ true };
+#else
+    constexpr bool POISON_FREED{ false };
+#endif
+
+    // Fixed-size blocks in power-of-two size classes, bumped from an arena whose
+    // memory is only returned when the pool is destroyed, so a block never moves.
+    // Each class keeps an intrusive free list, making allocate and release O(1).
+    // A request larger than MAX_BLOCK is mapped from the OS on its own and
+    // unmapped by release. Neither path goes through the global heap.
+    class Pool
+    {
+    public:
+        static constexpr std::size_t MIN_BLOCK{ 16 };
+        static constexpr std::size_t MAX_BLOCK{ 4096 };
+        static constexpr std::size_t CLASS_COUNT{ 9 };
+        static constexpr unsigned char POISON{ 0xDD };
+
+        Pool() = default;
+        ~Pool();
+        Pool(Pool const&) = delete;
+        Pool& operator=(Pool const&) = delete;
+
+        // Uninitialised, MIN_BLOCK-aligned storage, or nullptr when memory runs out.
+        void* allocate(std::size_t bytes);
+        // bytes must be the size the block was allocated with.
+        void release(void* block, std::size_t bytes);
+
+        // Bytes taken from the OS, for small blocks and large ones together.
+        std::size_t mappedBytes() const { return small.capacity() + largeBytes; }
+
+    private:
+        struct FreeBlock
+        {
+            FreeBlock* next;
+        };
+
+        // Header of every large block's mapping; the block sits directly after it.
+        struct alignas(MIN_BLOCK) Large
+        {
+            Large* prev;
+            Large* next;
+            std::size_t mapped;
+        };
+
+        FreeBlock* freeLists[CLASS_COUNT]{};
+        Arena small{};
+        Large* large{ nullptr };
+        std::size_t largeBytes{ 0 };
+
+        static std::size_t classOf(std::size_t bytes);
+        void checkPoison(FreeBlock const* block, std::size_t size) const;
+    };
+
+    // Integer cell blocks behind new, delete and pin. Handles carry a generation,
+    // so a stale one is reported, and a pinned block cannot be deleted. Each
+    // operation returns nullptr or the runtime error message.
+    class Heap
+    {
+    public:
+        static constexpr uint32_t MAX_CELLS{ 1u << 24 };
+
+        char const* create(int32_t first, int32_t last, int32_t& handle);
+        char const* release(int32_t handle);
+        char const* pin(int32_t handle);
+        char const* load(int32_t handle, int32_t index, int32_t& value) const;
+        char const* store(int32_t handle, int32_t index, int32_t value);
+
+    private:
+        static constexpr uint32_t SLOT_BITS{ 20 };
+        static constexpr uint32_t SLOT_MASK{ (1u << SLOT_BITS) - 1 };
+        static constexpr uint32_t GENERATION_MASK{ (1u << (31 - SLOT_BITS)) - 1 };
+
+        struct Block
+        {
+            int32_t* cells;
+            int32_t first;
+            uint32_t count;
+            uint32_t generation;
+            bool live;
+            bool pinned;
+        };
+
+        Pool pool{};
+        std::vector<Block> blocks{};
+        std::vector<uint32_t> freeSlots{};
+
+        Block const* find(int32_t handle) const;
+        Block* find(int32_t handle) { return const_cast<Block*>(static_cast<Heap const*>(this)->find(handle)); }
+        static char const* cell(Block const* block, int32_t index, uint32_t& offset);
+    };
+}
+
+#endif
@@ -0,0 +1,234 @@
+#include "pancscan.hpp"
+#include <bit>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PANC_SCAN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PANC_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PANC_TARGET(isa)
+#endif
+
+namespace panc::scan
+{
+    namespace
+    {
+        constexpr bool isSpace(unsigned char c)
+        {
+            return c == ' ' || static_cast<unsigned char>(c - '\t') <= 4 || c == 0xA0;
+        }
+
+        constexpr bool isDigit(unsigned char c)
+        {
+            return static_cast<unsigned char>(c - '0') <= 9;
+        }
+
+        constexpr bool isIdent(unsigned char c)
+        {
+            return static_cast<unsigned char>((c | 0x20) - 'a') <= 25 || isDigit(c) || c == '_';
+        }
+
+        char const* skipSpaceScalar(char const* p, char const* end)
+        {
+            while (p < end && isSpace(static_cast<unsigned char>(*p))) ++p;
+            return p;
+        }
+
+        char const* skipIdentScalar(char const* p, char const* end)
+        {
+            while (p < end && isIdent(static_cast<unsigned char>(*p))) ++p;
+            return p;
+        }
+
+        char const* skipDigitsScalar(char const* p, char const* end)
+        {
+            while (p < end && isDigit(static_cast<unsigned char>(*p))) ++p;
+            return p;
+        }
+
+        char const* findQuoteScalar(char const* p, char const* end, char quote)
+        {
+            while (p < end && *p != quote && *p != '\0') ++p;
+            return p;
+        }
+
+#ifdef PANC_SCAN_X86
+        // Unsigned "x <= bound" per byte: min(x, bound) == x.
+        PANC_TARGET("sse2") inline __m128i le16(__m128i x, char bound)
+        {
+            return _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(bound)), x);
+        }
+
+        PANC_TARGET("sse2") inline __m128i inRange16(__m128i c, char lo, char width)
+        {
+            return le16(_mm_sub_epi8(c, _mm_set1_epi8(lo)), width);
+        }
+
+        PANC_TARGET("sse2") inline unsigned miss16(__m128i hit)
+        {
+            return ~static_cast<unsigned>(_mm_movemask_epi8(hit)) & 0xFFFFu;
+        }
+
+        PANC_TARGET("sse2") inline __m128i load16(char const* p)
+        {
+            return _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+        }
+
+        PANC_TARGET("sse2") char const* skipSpaceSse2(char const* p, char const* end)
+        {
+            for (; end - p >= 16; p += 16)
+            {
+                __m128i const c{ load16(p) };
+                __m128i const hit{ _mm_or_si128(inRange16(c, '\t', 4),
+                    _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(c, _mm_set1_epi8(static_cast<char>(0xA0))))) };
+                if (unsigned const miss{ miss16(hit) }) return p + std::countr_zero(miss);
+            }
+            return skipSpaceScalar(p, end);
+        }
+
+        PANC_TARGET("sse2") char const* skipIdentSse2(char const* p, char const* end)
+        {
+            for (; end - p >= 16; p += 16)
+            {
+                __m128i const c{ load16(p) };
+                __m128i const alpha{ inRange16(_mm_or_si128(c, _mm_set1_epi8(0x20)), 'a', 25) };
+                __m128i const hit{ _mm_or_si128(alpha, _mm_or_si128(inRange16(c, '0', 9), _mm_cmpeq_epi8(c, _mm_set1_epi8('_')))) };
+                if (unsigned const miss{ miss16(hit) }) return p + std::countr_zero(miss);
+            }
+            return skipIdentScalar(p, end);
+        }
+
+        PANC_TARGET("sse2") char const* skipDigitsSse2(char const* p, char const* end)
+        {
+            for (; end - p >= 16; p += 16)
+                if (unsigned const miss{ miss16(inRange16(load16(p), '0', 9)) }) return p + std::countr_zero(miss);
+            return skipDigitsScalar(p, end);
+        }
+
+        PANC_TARGET("sse2") char const* findQuoteSse2(char const* p, char const* end, char quote)
+        {
+            for (; end - p >= 16; p += 16)
+            {
+                __m128i const c{ load16(p) };
+                __m128i const stop{ _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(quote)), _mm_cmpeq_epi8(c, _mm_setzero_si128())) };
+                if (unsigned const hit{ static_cast<unsigned>(_mm_movemask_epi8(stop)) }) return p + std::countr_zero(hit);
+            }
+            return findQuoteScalar(p, end, quote);
+        }
+
+        PANC_TARGET("avx2") inline __m256i le32(__m256i x, char bound)
+        {
+            return _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(bound)), x);
+        }
+
+        PANC_TARGET("avx2") inline __m256i inRange32(__m256i c, char lo, char width)
+        {
+            return le32(_mm256_sub_epi8(c, _mm256_set1_epi8(lo)), width);
+        }
+
+        PANC_TARGET("avx2") inline std::uint32_t miss32(__m256i hit)
+        {
+            return ~static_cast<std::uint32_t>(_mm256_movemask_epi8(hit));
+        }
+
+        PANC_TARGET("avx2") inline __m256i load32(char const* p)
+        {
+            return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+        }
+
+        PANC_TARGET("avx2") char const* skipSpaceAvx2(char const* p, char const* end)
+        {
+            for (; end - p >= 32; p += 32)
+            {
+                __m256i const c{ load32(p) };
+                __m256i const hit{ _mm256_or_si256(inRange32(c, '\t', 4),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(c, _mm256_set1_epi8(static_cast<char>(0xA0))))) };
+                if (std::uint32_t const miss{ miss32(hit) }) return p + std::countr_zero(miss);
+            }
+            return skipSpaceSse2(p, end);
+        }
+
+        PANC_TARGET("avx2") char const* skipIdentAvx2(char const* p, char const* end)
+        {
+            for (; end - p >= 32; p += 32)
+            {
+                __m256i const c{ load32(p) };
+                __m256i const alpha{ inRange32(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), 'a', 25) };
+                __m256i const hit{ _mm256_or_si256(alpha, _mm256_or_si256(inRange32(c, '0', 9), _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_')))) };
+                if (std::uint32_t const miss{ miss32(hit) }) return p + std::countr_zero(miss);
+            }
+            return skipIdentSse2(p, end);
+        }
+
+        PANC_TARGET("avx2") char const* skipDigitsAvx2(char const* p, char const* end)
+        {
+            for (; end - p >= 32; p += 32)
+                if (std::uint32_t const miss{ miss32(inRange32(load32(p), '0', 9)) }) return p + std::countr_zero(miss);
+            return skipDigitsSse2(p, end);
+        }
+
+        PANC_TARGET("avx2") char const* findQuoteAvx2(char const* p, char const* end, char quote)
+        {
+            for (; end - p >= 32; p += 32)
+            {
+                __m256i const c{ load32(p) };
+                __m256i const stop{ _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(quote)), _mm256_cmpeq_epi8(c, _mm256_setzero_si256())) };
+                if (std::uint32_t const hit{ static_cast<std::uint32_t>(_mm256_movemask_epi8(stop)) }) return p + std::countr_zero(hit);
+            }
+            return findQuoteSse2(p, end, quote);
+        }
+
+        bool cpuHasAvx2()
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            int regs[4]{};
+            __cpuid(regs, 0);
+            if (regs[0] < 7) return false;
+            __cpuid(regs, 1);
+            bool const osxsave{ (regs[2] & (1 << 27)) != 0 };
+            if (!osxsave || (_xgetbv(0) & 0x6) != 0x6) return false;
+            __cpuidex(regs, 7, 0);
+            return (regs[1] & (1 << 5)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+
+        constexpr Kernels sse2Kernels{ &skipSpaceSse2, &skipIdentSse2, &skipDigitsSse2, &findQuoteSse2, "sse2" };
+        constexpr Kernels avx2Kernels{ &skipSpaceAvx2, &skipIdentAvx2, &skipDigitsAvx2, &findQuoteAvx2, "avx2" };
+#endif
+
+        constexpr Kernels scalar{ &skipSpaceScalar, &skipIdentScalar, &skipDigitsScalar, &findQuoteScalar, "scalar" };
+
+        Kernels const& select()
+        {
+#ifdef PANC_SCAN_X86
+#if defined(__i386__) && !defined(__SSE2__)
+            if (!__builtin_cpu_supports("sse2")) return scalar;
+#endif
+            return cpuHasAvx2() ? avx2Kernels : sse2Kernels;
+#else
+            return scalar;
+#endif
+        }
+    }
+
+    Kernels const& kernels()
+    {
+        static Kernels const& selected{ select() };
+        return selected;
+    }
+
+    Kernels const& scalarKernels()
+    {
+        return scalar;
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef PANCSCAN_HPP
+#define PANCSCAN_HPP
+
+namespace panc::scan
+{
+    // Character-class run scanners used by the lexer. Each returns the first byte in
+    // [p, end) that is not part of the run; '\0' always ends a run.
+    struct Kernels
+    {
+        char const* (*skipSpace)(char const* p, char const* end);
+        char const* (*skipIdent)(char const* p, char const* end);
+        char const* (*skipDigits)(char const* p, char const* end);
+        char const* (*findQuote)(char const* p, char const* end, char quote);
+        char const* name;
+    };
+
+    Kernels const& kernels();
+    Kernels const& scalarKernels();
+}
+
+#endif
@@ -0,0 +1,240 @@
+#include "pancsource.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace panc
+{
+    namespace
+    {
+        constexpr std::size_t STREAM_CHUNK_SIZE{ 64 * 1024 };
+    }
+
+    SourceBuffer::SourceBuffer(SourceBuffer&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other) noexcept
+    {
+        if (this == &other) return *this;
+        close();
+        bytes = std::exchange(other.bytes, nullptr);
+        length = std::exchange(other.length, 0);
+        view = std::exchange(other.view, nullptr);
+        viewSize = std::exchange(other.viewSize, 0);
+        mappingHandle = std::exchange(other.mappingHandle, nullptr);
+        owned = std::move(other.owned);
+        other.owned.clear();
+        return *this;
+    }
+
+    SourceBuffer::~SourceBuffer()
+    {
+        close();
+    }
+
+    bool SourceBuffer::open(char const* path)
+    {
+        close();
+        if (std::strcmp(path, "-") == 0)
+            return openStream(stdin);
+
+        bool fallback{ false };
+        if (map(path, fallback)) return true;
+        if (!fallback) return false;
+
+        std::FILE* f{ std::fopen(path, "rb") };
+        if (!f) return false;
+        bool const ok{ openStream(f) };
+        std::fclose(f);
+        return ok;
+    }
+
+    bool SourceBuffer::openStream(std::FILE* stream)
+    {
+        close();
+#ifdef _WIN32
+        if (stream == stdin) _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        std::size_t used{ 0 };
+        while (true)
+        {
+            owned.resize(used + STREAM_CHUNK_SIZE);
+            std::size_t const got{ std::fread(owned.data() + used, 1, STREAM_CHUNK_SIZE, stream) };
+            used += got;
+            if (got < STREAM_CHUNK_SIZE) break;
+        }
+        if (std::ferror(stream))
+        {
+            owned.clear();
+            return false;
+        }
+        owned.resize(used + 1);
+        owned[used] = '\0';
+        adopt();
+        return true;
+    }
+
+    void SourceBuffer::adopt()
+    {
+        bytes = owned.data();
+        length = owned.empty() ? 0 : owned.size() - 1;
+    }
+
+#ifdef _WIN32
+    bool SourceBuffer::map(char const* path, bool& fallback)
+    {
+        HANDLE const file{ CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+        if (file == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER sz{};
+        SYSTEM_INFO info{};
+        GetSystemInfo(&info);
+        if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &sz) || sz.QuadPart == 0
+            || static_cast<unsigned long long>(sz.QuadPart) % info.dwPageSize == 0
+            || static_cast<unsigned long long>(sz.QuadPart) >= SIZE_MAX)
+        {
+            // Views cannot extend past the file, so a page-exact file has no room for the sentinel.
+            CloseHandle(file);
+            fallback = true;
+            return false;
+        }
+
+        HANDLE const mapping{ CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+        CloseHandle(file);
+        if (!mapping) return false;
+        void* const base{ MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) };
+        if (!base)
+        {
+            CloseHandle(mapping);
+            return false;
+        }
+
+        mappingHandle = mapping;
+        view = base;
+        viewSize = static_cast<std::size_t>(sz.QuadPart);
+        bytes = static_cast<char const*>(base);
+        length = viewSize;
+        return true;
+    }
+
+    void SourceBuffer::close()
+    {
+        if (view) UnmapViewOfFile(view);
+        if (mappingHandle) CloseHandle(static_cast<HANDLE>(mappingHandle));
+        view = nullptr;
+        mappingHandle = nullptr;
+        viewSize = 0;
+        bytes = nullptr;
+        length = 0;
+        owned.clear();
+    }
+#else
+    bool SourceBuffer::map(char const* path, bool& fallback)
+    {
+        int const fd{ ::open(path, O_RDONLY) };
+        if (fd < 0) return false;
+
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0
+            || static_cast<unsigned long long>(st.st_size) >= SIZE_MAX)
+        {
+            ::close(fd);
+            fallback = true;
+            return false;
+        }
+
+        std::size_t const fileSize{ static_cast<std::size_t>(st.st_size) };
+        std::size_t const page{ static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) };
+        std::size_t const reserveSize{ (fileSize + 1 + page - 1) / page * page };
+
+        // Reserve one byte past the file in anonymous zero pages, then map the file over
+        // the front of it; the sentinel is then free even when the size is page-exact.
+        void* const reserve{ mmap(nullptr, reserveSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) };
+        if (reserve == MAP_FAILED)
+        {
+            ::close(fd);
+            return false;
+        }
+        void* const base{ mmap(reserve, fileSize, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) };
+        ::close(fd);
+        if (base == MAP_FAILED)
+        {
+            munmap(reserve, reserveSize);
+            return false;
+        }
+        madvise(base, fileSize, MADV_SEQUENTIAL);
+
+        view = base;
+        viewSize = reserveSize;
+        bytes = static_cast<char const*>(base);
+        length = fileSize;
+        return true;
+    }
+
+    void SourceBuffer::close()
+    {
+        if (view) munmap(view, viewSize);
+        view = nullptr;
+        mappingHandle = nullptr;
+        viewSize = 0;
+        bytes = nullptr;
+        length = 0;
+        owned.clear();
+    }
+#endif
+
+    LineTable::LineTable(char const* src, std::size_t len) : source(src), length(len) {}
+
+    LineTable::LineTable(SourceBuffer const& buffer) : source(buffer.data()), length(buffer.size()) {}
+
+    SourceLocation LineTable::locate(std::uint32_t offset) const
+    {
+        build();
+        auto const next{ std::upper_bound(starts.begin(), starts.end(), offset) };
+        std::size_t const line{ static_cast<std::size_t>(next - starts.begin()) };
+        return { line, offset - starts[line - 1] + std::size_t{ 1 } };
+    }
+
+    std::size_t LineTable::lineCount() const
+    {
+        build();
+        return starts.size();
+    }
+
+    std::uint32_t LineTable::lineStart(std::size_t line) const
+    {
+        build();
+        return starts[line - 1];
+    }
+
+    void LineTable::build() const
+    {
+        if (built) return;
+        char const* const end{ source + length };
+        starts.push_back(0);
+        for (char const* p{ source }; p < end; ++p)
+        {
+            p = static_cast<char const*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+            if (!p) break;
+            starts.push_back(static_cast<std::uint32_t>(p + 1 - source));
+        }
+        built = true;
+    }
+}
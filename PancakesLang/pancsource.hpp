@@ -0,0 +1,77 @@
+#ifndef PANCSOURCE_HPP
+#define PANCSOURCE_HPP
+
+#include "pancutil.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace panc
+{
+    // Read-only view of a source file. Regular files are memory-mapped, pipes and
+    // stdin ("-") are streamed into an owned buffer. Either way data()[size()] is '\0'.
+    class SourceBuffer
+    {
+        char const* bytes{ nullptr };
+        std::size_t length{ 0 };
+        void* view{ nullptr };
+        std::size_t viewSize{ 0 };
+        void* mappingHandle{ nullptr };
+        std::vector<char> owned{};
+
+    public:
+        SourceBuffer() = default;
+        SourceBuffer(SourceBuffer const&) = delete;
+        SourceBuffer& operator=(SourceBuffer const&) = delete;
+        SourceBuffer(SourceBuffer&& other) noexcept;
+        SourceBuffer& operator=(SourceBuffer&& other) noexcept;
+        ~SourceBuffer();
+
+        bool open(char const* path);
+        bool openStream(std::FILE* stream);
+        void close();
+
+        [[nodiscard]] char const* data() const
+        {
+            return bytes;
+        }
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return length;
+        }
+
+        [[nodiscard]] bool mapped() const
+        {
+            return view != nullptr;
+        }
+
+    private:
+        bool map(char const* path, bool& fallback);
+        void adopt();
+    };
+
+    // Offsets of every line start, built on the first lookup so files that lex and
+    // parse cleanly never pay for it.
+    class LineTable
+    {
+        char const* source;
+        std::size_t length;
+        mutable std::vector<std::uint32_t> starts{};
+        mutable bool built{ false };
+
+    public:
+        LineTable(char const* src, std::size_t len);
+        explicit LineTable(SourceBuffer const& buffer);
+
+        SourceLocation locate(std::uint32_t offset) const;
+        std::size_t lineCount() const;
+        std::uint32_t lineStart(std::size_t line) const;
+
+    private:
+        void build() const;
+    };
+}
+
+#endif
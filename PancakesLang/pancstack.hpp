@@ -0,0 +1,81 @@
+#ifndef PANCSTACK_HPP
+#define PANCSTACK_HPP
+
+#include "pancdef.hpp"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace panc
+{
+    // Release builds may define PANC_UNCHECKED_STACKS to drop the bounds checks
+    // on the language value stacks; overflow and underflow are then undefined
+    // behaviour, caught only by the asserts of a debug build.
+#ifdef PANC_UNCHECKED_STACKS
+    constexpr bool CHECKED_STACKS{ false };
+#else
+    constexpr bool CHECKED_STACKS{ true };
+#endif
+
+    constexpr std::size_t CACHE_LINE_SIZE{ 64 };
+
+    // A contiguous, fixed-capacity stack of one primitive type, starting on its own
+    // cache line. Each operation is at most one bounds check and one move. A
+    // failed operation returns false for the caller to report, and nothing is
+    // dropped silently the way panc::array::push_back drops it.
+    template<typename T, std::size_t Capacity, bool Checked = CHECKED_STACKS>
+    class TypedStack
+    {
+        alignas(CACHE_LINE_SIZE) T slots[Capacity]{};
+        std::size_t count{ 0 };
+
+    public:
+        [[nodiscard]] bool push(T value)
+        {
+            if constexpr (Checked)
+            {
+                if (count == Capacity) return false;
+            }
+            assert(count < Capacity);
+            slots[count++] = value;
+            return true;
+        }
+
+        [[nodiscard]] bool pop(T& out)
+        {
+            if constexpr (Checked)
+            {
+                if (count == 0) return false;
+            }
+            assert(count > 0);
+            out = slots[--count];
+            return true;
+        }
+
+        // Discards the top value, overwriting its slot with zero.
+        [[nodiscard]] bool destroy()
+        {
+            if constexpr (Checked)
+            {
+                if (count == 0) return false;
+            }
+            assert(count > 0);
+            slots[--count] = T{};
+            return true;
+        }
+
+        void clear() { count = 0; }
+        [[nodiscard]] bool empty() const { return count == 0; }
+        [[nodiscard]] std::size_t size() const { return count; }
+        [[nodiscard]] static constexpr std::size_t capacity() { return Capacity; }
+    };
+
+    // One stack per primitive type, as "push", "pop <type>" and "destroy <type>" see them.
+    struct ValueStacks
+    {
+        TypedStack<int32_t, VALUE_STACK_SIZE> integers{};
+        TypedStack<double, VALUE_STACK_SIZE> floats{};
+    };
+}
+
+#endif
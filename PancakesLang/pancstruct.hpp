@@ -0,0 +1,67 @@
+#ifndef PANCSTRUCT_HPP
+#define PANCSTRUCT_HPP
+
+#include "pancast.hpp"
+#include <algorithm>
+#include <cstdint>
+
+namespace panc
+{
+    // Structures are stored in 32-bit forth cells: an integer field takes one
+    // cell and a float field, a double, takes two.
+    constexpr uint32_t CELL_BYTES{ 4 };
+
+    constexpr uint32_t alignUp(uint32_t value, uint32_t align)
+    {
+        return (value + align - 1) / align * align;
+    }
+
+    // Sets every field's byte_offset, then the structure's size and align.
+    inline void layOut(Structure& s)
+    {
+        uint32_t offset{ 0 };
+        s.align = CELL_BYTES;
+        for (StructField* f{ s.fields }; f; f = f->next)
+        {
+            f->byte_offset = alignUp(offset, f->size);
+            offset = f->byte_offset + f->size;
+            s.align = std::max(s.align, f->size);
+        }
+        s.size = alignUp(offset, s.align);
+    }
+
+    // Byte offset of field's array in a struct-of-arrays of count elements;
+    // with no field, the size of the whole thing.
+    inline uint32_t soaOffset(Structure const& s, StructField const* field, uint32_t count)
+    {
+        uint32_t offset{ 0 };
+        for (StructField const* f{ s.fields }; f; f = f->next)
+        {
+            offset = alignUp(offset, f->size);
+            if (f == field) return offset;
+            offset += count * f->size;
+        }
+        return alignUp(offset, s.align);
+    }
+
+    inline uint32_t arrayBytes(Structure const& s, uint32_t count, bool soa)
+    {
+        return soa ? soaOffset(s, nullptr, count) : count * s.size;
+    }
+
+    // Where a field of element 0 starts within its variable, and the distance
+    // from one element's field to the next, both in cells.
+    struct FieldAccess
+    {
+        uint32_t first;
+        uint32_t stride;
+    };
+
+    inline FieldAccess fieldAccess(ClassVar const& var, StructField const& field)
+    {
+        if (var.soa) return { soaOffset(*var.structure, &field, var.count) / CELL_BYTES, field.size / CELL_BYTES };
+        return { field.byte_offset / CELL_BYTES, var.structure->size / CELL_BYTES };
+    }
+}
+
+#endif
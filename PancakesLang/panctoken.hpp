@@ -9,7 +9,10 @@ namespace panc
     {
         IDENTIFIER, STRING, NUMBER,
         K_SECTION, K_END, K_FUNCTION, K_CLASS, K_ONLY, K_AS, K_RETURN, K_MAIN, K_DO, K_IS, K_PROCEDURE,
-        COMMA, COLON, SEMICOLON, LPAREN, RPAREN, DOT, EQUAL, PLUS, MINUS,
+        K_LOOP, K_FOR, K_IN, K_LOCAL, K_MANUAL, K_PIN, K_PINNED, K_PUSH, K_POP, K_NEW, K_DELETE, K_DESTROY,
+        K_LEAVE, K_FROM, K_FORTH, K_LOWLEVEL, K_STRUCTURE, K_ALLOCATE, K_CELLS, K_SIZEOF,
+        COMMA, COLON, SEMICOLON, LPAREN, RPAREN, DOT, EQUAL, PLUS, MINUS, STAR, SLASH, LESS, GREATER, ARROW,
+        BANG, AT, LBRACE, RBRACE,
         UNTERMINATED_STRING, END_OF_FILE, UNKNOWN
     };
 
@@ -31,6 +34,26 @@ namespace panc
         case TokenType::K_DO: return "K_DO";
         case TokenType::K_IS: return "K_IS";
         case TokenType::K_PROCEDURE: return "K_PROCEDURE";
+        case TokenType::K_LOOP: return "K_LOOP";
+        case TokenType::K_FOR: return "K_FOR";
+        case TokenType::K_IN: return "K_IN";
+        case TokenType::K_LOCAL: return "K_LOCAL";
+        case TokenType::K_MANUAL: return "K_MANUAL";
+        case TokenType::K_PIN: return "K_PIN";
+        case TokenType::K_PINNED: return "K_PINNED";
+        case TokenType::K_PUSH: return "K_PUSH";
+        case TokenType::K_POP: return "K_POP";
+        case TokenType::K_NEW: return "K_NEW";
+        case TokenType::K_DELETE: return "K_DELETE";
+        case TokenType::K_DESTROY: return "K_DESTROY";
+        case TokenType::K_LEAVE: return "K_LEAVE";
+        case TokenType::K_FROM: return "K_FROM";
+        case TokenType::K_FORTH: return "K_FORTH";
+        case TokenType::K_LOWLEVEL: return "K_LOWLEVEL";
+        case TokenType::K_STRUCTURE: return "K_STRUCTURE";
+        case TokenType::K_ALLOCATE: return "K_ALLOCATE";
+        case TokenType::K_CELLS: return "K_CELLS";
+        case TokenType::K_SIZEOF: return "K_SIZEOF";
         case TokenType::COMMA: return "COMMA";
         case TokenType::COLON: return "COLON";
         case TokenType::SEMICOLON: return "SEMICOLON";
@@ -40,6 +63,15 @@ namespace panc
         case TokenType::EQUAL: return "EQUAL";
         case TokenType::PLUS: return "PLUS";
         case TokenType::MINUS: return "MINUS";
+        case TokenType::STAR: return "STAR";
+        case TokenType::SLASH: return "SLASH";
+        case TokenType::LESS: return "LESS";
+        case TokenType::GREATER: return "GREATER";
+        case TokenType::ARROW: return "ARROW";
+        case TokenType::BANG: return "BANG";
+        case TokenType::AT: return "AT";
+        case TokenType::LBRACE: return "LBRACE";
+        case TokenType::RBRACE: return "RBRACE";
         case TokenType::UNTERMINATED_STRING: return "UNTERMINATED_STRING";
         case TokenType::END_OF_FILE: return "END_OF_FILE";
         case TokenType::UNKNOWN: return "UNKNOWN";
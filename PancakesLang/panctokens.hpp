@@ -0,0 +1,125 @@
+#ifndef PANCTOKENS_HPP
+#define PANCTOKENS_HPP
+
+#include "pancutil.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace panc
+{
+    // Struct-of-arrays token storage: 1-byte type, 32-bit value offset and 32-bit
+    // length per token (9 bytes against 32 for an unpacked Token). Values are
+    // re-sliced from the source on access.
+    class TokenBuffer
+    {
+        char const* source{ nullptr };
+        std::vector<std::uint8_t> types{};
+        std::vector<std::uint32_t> offsets{};
+        std::vector<std::uint32_t> lengths{};
+
+    public:
+        TokenBuffer() = default;
+
+        explicit TokenBuffer(char const* src) : source(src) {}
+
+        void push_back(Token const& t)
+        {
+            types.push_back(static_cast<std::uint8_t>(t.type));
+            offsets.push_back(isQuoted(t.type) ? t.offset + 1 : t.offset);
+            lengths.push_back(static_cast<std::uint32_t>(t.value.size()));
+        }
+
+        void append(TokenBuffer const& other)
+        {
+            types.insert(types.end(), other.types.begin(), other.types.end());
+            offsets.insert(offsets.end(), other.offsets.begin(), other.offsets.end());
+            lengths.insert(lengths.end(), other.lengths.begin(), other.lengths.end());
+        }
+
+        bool operator==(TokenBuffer const& other) const
+        {
+            return types == other.types && offsets == other.offsets && lengths == other.lengths;
+        }
+
+        Token operator[](std::size_t i) const
+        {
+            TokenType const type{ this->type(i) };
+            std::uint32_t const at{ offsets[i] };
+            return { type, { source + at, lengths[i] }, isQuoted(type) ? at - 1 : at };
+        }
+
+        [[nodiscard]] TokenType type(std::size_t i) const
+        {
+            return static_cast<TokenType>(types[i]);
+        }
+
+        // Source offset of the token itself, i.e. of the opening quote for strings.
+        [[nodiscard]] std::uint32_t offset(std::size_t i) const
+        {
+            return isQuoted(type(i)) ? offsets[i] - 1 : offsets[i];
+        }
+
+        [[nodiscard]] std::uint32_t valueOffset(std::size_t i) const
+        {
+            return offsets[i];
+        }
+
+        [[nodiscard]] std::uint32_t length(std::size_t i) const
+        {
+            return lengths[i];
+        }
+
+        [[nodiscard]] char const* text() const
+        {
+            return source;
+        }
+
+        [[nodiscard]] std::uint8_t const* typeData() const
+        {
+            return types.data();
+        }
+
+        [[nodiscard]] std::uint32_t const* offsetData() const
+        {
+            return offsets.data();
+        }
+
+        [[nodiscard]] std::uint32_t const* lengthData() const
+        {
+            return lengths.data();
+        }
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return types.size();
+        }
+
+        [[nodiscard]] bool empty() const
+        {
+            return types.empty();
+        }
+
+        void reserve(std::size_t n)
+        {
+            types.reserve(n);
+            offsets.reserve(n);
+            lengths.reserve(n);
+        }
+
+        void clear()
+        {
+            types.clear();
+            offsets.clear();
+            lengths.clear();
+        }
+
+    private:
+        static constexpr bool isQuoted(TokenType t)
+        {
+            return t == TokenType::STRING || t == TokenType::UNTERMINATED_STRING;
+        }
+    };
+}
+
+#endif
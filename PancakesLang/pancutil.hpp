@@ -2,6 +2,8 @@
 #define PANCUTIL_HPP
 
 #include "panctoken.hpp"
+#include <cstddef>
+#include <cstdint>
 
 namespace panc
 {
@@ -15,14 +17,14 @@ namespace panc
     {
         TokenType type{ TokenType::UNKNOWN };
         std::string_view value{};
-        SourceLocation position{};
+        std::uint32_t offset{ 0 };
     };
 
     struct BlockInfo
     {
         TokenType openKind{ TokenType::UNKNOWN };
         std::string_view name{};
-        SourceLocation position{};
+        std::uint32_t offset{ 0 };
     };
 
     struct SyntaxError
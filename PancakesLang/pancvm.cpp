@@ -0,0 +1,503 @@
+#include "pancvm.hpp"
+#include "pancdef.hpp"
+#include "pancpool.hpp"
+#include "pancstack.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+
+namespace panc
+{
+    namespace
+    {
+        constexpr std::size_t VM_STACK_SIZE{ 64 * 1024 };
+
+        static_assert(static_cast<int>(Op::SUB) - static_cast<int>(Op::ADD) == static_cast<int>(BinaryOp::SUB)
+            && static_cast<int>(Op::GT) - static_cast<int>(Op::ADD) == static_cast<int>(BinaryOp::GT),
+            "binary opcodes must follow BinaryOp order");
+
+        struct Compiler : ExprVisitor<Compiler, bool, Expr const>
+        {
+            Program const& program;
+            StringTable const& strings;
+            Bytecode& out;
+            uint32_t const printLine{ strings.find("print_line") };
+            uint32_t const integerType{ strings.find("integer") };
+            uint32_t const newName{ strings.find("new") };
+            uint32_t const deleteName{ strings.find("delete") };
+            uint32_t const pinName{ strings.find("pin") };
+            std::vector<uint32_t> functionOf{};
+            std::vector<int32_t> slotOf{};
+            // Variables assigned on every path to the statement being compiled,
+            // in the order they became so, for loops to forget their bodies' own.
+            std::vector<bool> assigned{};
+            std::vector<uint32_t> assignedOrder{};
+            // Counters of the loops around the statement being compiled.
+            std::vector<uint32_t> loopVars{};
+            Procedure const* proc{ nullptr };
+            uint32_t locals{ 0 };
+            int32_t depth{ 0 };
+            int32_t maxDepth{ 0 };
+
+            Compiler(Program const& source, StringTable const& names, Bytecode& target)
+                : program(source), strings(names), out(target),
+                functionOf(names.size(), 0), slotOf(names.size(), -1), assigned(names.size(), false) {}
+
+            void emit(Op op, int32_t arg, int32_t delta)
+            {
+                out.code.push_back({ op, arg });
+                depth += delta;
+                maxDepth = std::max(maxDepth, depth);
+            }
+
+            bool error(char const* what, uint32_t name)
+            {
+                std::cerr << "Compile Error: " << what << strings.get(name)
+                    << " in procedure " << strings.get(proc->name_idx) << '\n';
+                return false;
+            }
+
+            bool visitLiteral(Expr const* e)
+            {
+                emit(Op::CONST, e->getLiteralValue(), 1);
+                return true;
+            }
+
+            bool visitString(Expr const* e)
+            {
+                return error("string used as a number: ", e->getStringIdx());
+            }
+
+            int32_t assign(uint32_t name)
+            {
+                int32_t& slot{ slotOf[name] };
+                if (slot < 0) slot = static_cast<int32_t>(locals++);
+                if (!assigned[name])
+                {
+                    assigned[name] = true;
+                    assignedOrder.push_back(name);
+                }
+                return slot;
+            }
+
+            bool visitVariable(Expr const* e)
+            {
+                int32_t const slot{ slotOf[e->getVariableNameIdx()] };
+                if (slot < 0) return error("undefined variable ", e->getVariableNameIdx());
+                if (!assigned[e->getVariableNameIdx()]) return error("variable read before it is assigned: ", e->getVariableNameIdx());
+                emit(Op::LOAD, slot, 1);
+                return true;
+            }
+
+            // Either the builtin new, or H(i) reading cell i of the block handle H holds.
+            bool visitFuncCall(Expr const* e)
+            {
+                if (e->getFuncId() == newName)
+                {
+                    if (!visit(e->getArg(0)) || !visit(e->getArg(1))) return false;
+                    emit(Op::NEW, 0, -1);
+                    return true;
+                }
+                int32_t const slot{ slotOf[e->getFuncId()] };
+                if (slot < 0 || e->getArgCount() != 1) return error("call does not produce a value: ", e->getFuncId());
+                if (!assigned[e->getFuncId()]) return error("variable read before it is assigned: ", e->getFuncId());
+                emit(Op::LOAD, slot, 1);
+                if (!visit(e->getArg(0))) return false;
+                emit(Op::CELL_LOAD, 0, -1);
+                return true;
+            }
+
+            bool visitUnary(Expr const* e)
+            {
+                if (!visit(e->getOperand())) return false;
+                emit(Op::NEG, 0, 0);
+                return true;
+            }
+
+            bool visitBinary(Expr const* e)
+            {
+                if (!visit(e->getLhs()) || !visit(e->getRhs())) return false;
+                emit(static_cast<Op>(static_cast<int>(Op::ADD) + static_cast<int>(e->getBinaryOp())), 0, -1);
+                return true;
+            }
+
+            bool visitPop(Expr const* e)
+            {
+                if (e->getPopTypeIdx() != integerType) return error("only integer values can be popped, not ", e->getPopTypeIdx());
+                emit(Op::POP, 0, 1);
+                return true;
+            }
+
+            bool call(Expr const& e)
+            {
+                if (e.getFuncId() == printLine)
+                {
+                    for (uint32_t i{ 0 }; i < e.getArgCount(); ++i)
+                    {
+                        Expr const* const arg{ e.getArg(i) };
+                        if (arg->isString())
+                            emit(Op::PRINT_STR, static_cast<int32_t>(arg->getStringIdx()), 0);
+                        else if (visit(arg))
+                            emit(Op::PRINT_INT, 0, -1);
+                        else
+                            return false;
+                    }
+                    emit(Op::PRINT_END, 0, 0);
+                    return true;
+                }
+                if (e.getFuncId() == deleteName || e.getFuncId() == pinName)
+                {
+                    if (!visit(e.getArg(0))) return false;
+                    emit(e.getFuncId() == deleteName ? Op::DELETE : Op::PIN, 0, -1);
+                    return true;
+                }
+
+                uint32_t const index{ functionOf[e.getFuncId()] };
+                if (index == 0) return error("unknown procedure ", e.getFuncId());
+                Function const& target{ out.functions[index - 1] };
+                if (e.getArgCount() != target.params) return error("wrong number of arguments to ", e.getFuncId());
+                for (uint32_t i{ 0 }; i < e.getArgCount(); ++i)
+                    if (!visit(e.getArg(i)))
+                        return false;
+                emit(Op::CALL, static_cast<int32_t>(index - 1), -static_cast<int32_t>(target.params));
+                return true;
+            }
+
+            bool statement(Stmt const& s)
+            {
+                switch (s.kind)
+                {
+                case StmtKind::CALL:
+                    return call(*s.call.expr);
+                case StmtKind::ASSIGN:
+                {
+                    Expr const& target{ *s.assign.target };
+                    if (target.isFuncCall()) return storeCell(target, *s.assign.value);
+                    if (isLoopVar(target.getVariableNameIdx())) return error("cannot assign to loop variable ", target.getVariableNameIdx());
+                    if (!visit(s.assign.value)) return false;
+                    emit(Op::STORE, assign(target.getVariableNameIdx()), -1);
+                    return true;
+                }
+                case StmtKind::PUSH:
+                    if (!visit(s.push.value)) return false;
+                    emit(Op::PUSH, 0, -1);
+                    return true;
+                case StmtKind::FOR:
+                    return loop(s);
+                case StmtKind::DESTROY:
+                    if (s.destroy.type_idx != integerType) return error("only integer values can be destroyed, not ", s.destroy.type_idx);
+                    emit(Op::DESTROY, 0, 0);
+                    return true;
+                }
+                return false;
+            }
+
+            // H(i) <- value
+            bool storeCell(Expr const& target, Expr const& value)
+            {
+                int32_t const slot{ slotOf[target.getFuncId()] };
+                if (slot < 0 || target.getArgCount() != 1) return error("cannot assign to ", target.getFuncId());
+                if (!assigned[target.getFuncId()]) return error("variable read before it is assigned: ", target.getFuncId());
+                emit(Op::LOAD, slot, 1);
+                if (!visit(target.getArg(0)) || !visit(&value)) return false;
+                emit(Op::CELL_STORE, 0, -3);
+                return true;
+            }
+
+            bool isLoopVar(uint32_t name) const
+            {
+                return std::find(loopVars.begin(), loopVars.end(), name) != loopVars.end();
+            }
+
+            // Tests for the last iteration before incrementing, so last may be INT32_MAX.
+            // Only the loop itself changes its counter, so the test always reaches last.
+            bool loop(Stmt const& s)
+            {
+                if (isLoopVar(s.loop.var_idx)) return error("cannot assign to loop variable ", s.loop.var_idx);
+                if (!visit(s.loop.first)) return false;
+                int32_t const slot{ assign(s.loop.var_idx) };
+                emit(Op::STORE, slot, -1);
+                if (!visit(s.loop.last)) return false;
+                int32_t const last{ static_cast<int32_t>(locals++) };
+                emit(Op::STORE, last, -1);
+
+                emit(Op::LOAD, slot, 1);
+                emit(Op::LOAD, last, 1);
+                emit(Op::GT, 0, -1);
+                std::size_t const skip{ out.code.size() };
+                emit(Op::JUMP_IF, 0, -1);
+                int32_t const top{ static_cast<int32_t>(out.code.size()) };
+                std::size_t const before{ assignedOrder.size() };
+                loopVars.push_back(s.loop.var_idx);
+                for (Stmt const* inner{ s.loop.body }; inner; inner = inner->next)
+                    if (!statement(*inner))
+                        return false;
+                loopVars.pop_back();
+                // Unless the bounds show it runs, the body may not have assigned anything.
+                bool const runs{ s.loop.first->isLiteral() && s.loop.last->isLiteral()
+                    && s.loop.first->getLiteralValue() <= s.loop.last->getLiteralValue() };
+                for (; !runs && assignedOrder.size() > before; assignedOrder.pop_back())
+                    assigned[assignedOrder.back()] = false;
+                emit(Op::LOAD, slot, 1);
+                emit(Op::LOAD, last, 1);
+                emit(Op::EQ, 0, -1);
+                std::size_t const exit{ out.code.size() };
+                emit(Op::JUMP_IF, 0, -1);
+                emit(Op::LOAD, slot, 1);
+                emit(Op::CONST, 1, 1);
+                emit(Op::ADD, 0, -1);
+                emit(Op::STORE, slot, -1);
+                emit(Op::JUMP, top, 0);
+                out.code[skip].arg = out.code[exit].arg = static_cast<int32_t>(out.code.size());
+                return true;
+            }
+
+            bool procedure(Procedure const& p, Function& f)
+            {
+                proc = &p;
+                std::fill(slotOf.begin(), slotOf.end(), -1);
+                for (uint32_t const name : assignedOrder) assigned[name] = false;
+                assignedOrder.clear();
+                loopVars.clear();
+                locals = 0;
+                depth = maxDepth = 0;
+                f.entry = static_cast<uint32_t>(out.code.size());
+                for (Param const* param{ p.params }; param; param = param->next)
+                {
+                    slotOf[param->name_idx] = static_cast<int32_t>(locals++);
+                    assign(param->name_idx);
+                }
+                for (Param const* local{ p.locals }; local; local = local->next)
+                {
+                    emit(Op::CONST, 0, 1);
+                    emit(Op::STORE, assign(local->name_idx), -1);
+                }
+                for (Stmt const* s{ p.body }; s; s = s->next)
+                    if (!statement(*s))
+                        return false;
+                emit(Op::RET, 0, 0);
+                f.locals = locals;
+                f.maxStack = static_cast<uint32_t>(maxDepth);
+                return true;
+            }
+
+            bool compile()
+            {
+                if (!program.main)
+                {
+                    std::cerr << "Runtime Error: main procedure not found\n";
+                    return false;
+                }
+                // Declare every procedure first so calls may precede definitions.
+                bool ok{ true };
+                for (Procedure const* p{ program.procedures }; p; p = p->next)
+                {
+                    if (p == program.main) out.main = static_cast<uint32_t>(out.functions.size());
+                    out.functions.push_back({ p->name_idx, 0, p->param_count, 0, 0 });
+                    if (functionOf[p->name_idx] == 0)
+                        functionOf[p->name_idx] = static_cast<uint32_t>(out.functions.size());
+                    else
+                    {
+                        std::cerr << "Compile Error: duplicate procedure " << strings.get(p->name_idx) << '\n';
+                        ok = false;
+                    }
+                }
+                std::size_t i{ 0 };
+                for (Procedure const* p{ program.procedures }; p; p = p->next, ++i)
+                    ok = procedure(*p, out.functions[i]) && ok;
+                return ok;
+            }
+        };
+
+#if PANC_THREADED_DISPATCH
+        struct Cell
+        {
+            void const* target;
+            int32_t arg;
+        };
+#else
+        using Cell = Instr;
+#endif
+
+        struct CallFrame
+        {
+            Cell const* ret;
+            int32_t* base;
+        };
+
+        bool fail(char const* message)
+        {
+            std::cerr << "Runtime Error: " << message << '\n';
+            return false;
+        }
+    }
+
+    bool compile(Program const& program, StringTable const& strings, Bytecode& out)
+    {
+        out = Bytecode{};
+        return Compiler{ program, strings, out }.compile();
+    }
+
+#if PANC_THREADED_DISPATCH
+#define VM_OP(name) op_##name:
+#define VM_DISPATCH() goto *ip->target
+#else
+#define VM_OP(name) case Op::name:
+#define VM_DISPATCH() goto dispatch
+#endif
+#define VM_NEXT() do { ++ip; VM_DISPATCH(); } while (0)
+#define VM_BINARY(expr) do { --sp; uint32_t const a{ static_cast<uint32_t>(sp[-1]) }, b{ static_cast<uint32_t>(*sp) }; \
+    (void)a; (void)b; sp[-1] = static_cast<int32_t>(expr); VM_NEXT(); } while (0)
+
+    // Calls check the callee's whole frame against the stack limit up front, so
+    // individual pushes never do. Arguments become the first callee locals in
+    // place, and RET drops the frame by resetting sp to its base.
+    bool run(Bytecode const& bytecode, StringTable const& strings)
+    {
+        std::vector<Function> const& functions{ bytecode.functions };
+#if PANC_THREADED_DISPATCH
+        static void const* const handlers[]
+        {
+            &&op_CONST, &&op_LOAD, &&op_STORE, &&op_ADD, &&op_SUB, &&op_MUL, &&op_DIV, &&op_EQ, &&op_LT, &&op_GT,
+            &&op_NEG, &&op_PUSH, &&op_POP, &&op_CALL, &&op_RET, &&op_PRINT_STR, &&op_PRINT_INT, &&op_PRINT_END,
+            &&op_JUMP, &&op_JUMP_IF, &&op_DESTROY, &&op_NEW, &&op_CELL_LOAD, &&op_CELL_STORE, &&op_DELETE, &&op_PIN
+        };
+        static_assert(std::size(handlers) == static_cast<std::size_t>(Op::PIN) + 1, "one handler per opcode");
+        std::vector<Cell> code(bytecode.code.size());
+        for (std::size_t i{ 0 }; i < code.size(); ++i)
+            code[i] = { handlers[static_cast<std::size_t>(bytecode.code[i].op)], bytecode.code[i].arg };
+#else
+        std::vector<Cell> const& code{ bytecode.code };
+#endif
+
+        std::vector<int32_t> stack(VM_STACK_SIZE);
+        int32_t* const limit{ stack.data() + stack.size() };
+        ValueStacks stacks{};
+        Heap heap{};
+        CallFrame frames[MAX_STACK_DEPTH];
+        std::size_t depth{ 0 };
+
+        Function const& entry{ functions[bytecode.main] };
+        if (entry.locals + entry.maxStack > stack.size()) return fail("stack overflow");
+        int32_t* base{ stack.data() };
+        int32_t* sp{ base + entry.locals };
+        Cell const* ip{ code.data() + entry.entry };
+
+#if PANC_THREADED_DISPATCH
+        VM_DISPATCH();
+#else
+    dispatch:
+        switch (ip->op)
+        {
+#endif
+        VM_OP(CONST)
+            *sp++ = ip->arg;
+            VM_NEXT();
+        VM_OP(LOAD)
+            *sp++ = base[ip->arg];
+            VM_NEXT();
+        VM_OP(STORE)
+            base[ip->arg] = *--sp;
+            VM_NEXT();
+        VM_OP(ADD)
+            VM_BINARY(a + b);
+        VM_OP(SUB)
+            VM_BINARY(a - b);
+        VM_OP(MUL)
+            VM_BINARY(a * b);
+        VM_OP(DIV)
+            if (sp[-1] == 0) return fail("division by zero");
+            VM_BINARY((sp[-1] == INT32_MIN && *sp == -1) ? INT32_MIN : sp[-1] / *sp);
+        VM_OP(EQ)
+            VM_BINARY(a == b);
+        VM_OP(LT)
+            VM_BINARY(sp[-1] < *sp);
+        VM_OP(GT)
+            VM_BINARY(sp[-1] > *sp);
+        VM_OP(NEG)
+            sp[-1] = static_cast<int32_t>(0u - static_cast<uint32_t>(sp[-1]));
+            VM_NEXT();
+        VM_OP(PUSH)
+            if (!stacks.integers.push(*--sp)) return fail("stack overflow");
+            VM_NEXT();
+        VM_OP(POP)
+            if (!stacks.integers.pop(*sp++)) return fail("stack underflow");
+            VM_NEXT();
+        VM_OP(CALL)
+        {
+            Function const& f{ functions[static_cast<std::size_t>(ip->arg)] };
+            if (depth + 1 >= MAX_STACK_DEPTH)
+            {
+                std::cerr << "Runtime Error: call depth exceeded in " << strings.get(f.name) << '\n';
+                return false;
+            }
+            int32_t* const callee{ sp - f.params };
+            if (static_cast<std::size_t>(limit - callee) < std::size_t{ f.locals } + f.maxStack) return fail("stack overflow");
+            std::fill(sp, callee + f.locals, 0);
+            frames[depth++] = { ip + 1, base };
+            base = callee;
+            sp = callee + f.locals;
+            ip = code.data() + f.entry;
+            VM_DISPATCH();
+        }
+        VM_OP(RET)
+            if (depth == 0) return true;
+            sp = base;
+            --depth;
+            ip = frames[depth].ret;
+            base = frames[depth].base;
+            VM_DISPATCH();
+        VM_OP(PRINT_STR)
+            std::cout << strings.get(static_cast<uint32_t>(ip->arg));
+            VM_NEXT();
+        VM_OP(PRINT_INT)
+            std::cout << *--sp;
+            VM_NEXT();
+        VM_OP(PRINT_END)
+            std::cout << '\n';
+            VM_NEXT();
+        VM_OP(JUMP)
+            ip = code.data() + ip->arg;
+            VM_DISPATCH();
+        VM_OP(JUMP_IF)
+            if (*--sp == 0) VM_NEXT();
+            ip = code.data() + ip->arg;
+            VM_DISPATCH();
+        VM_OP(DESTROY)
+            if (!stacks.integers.destroy()) return fail("stack underflow");
+            VM_NEXT();
+        VM_OP(NEW)
+        {
+            int32_t handle{};
+            --sp;
+            if (char const* const error{ heap.create(sp[-1], *sp, handle) }) return fail(error);
+            sp[-1] = handle;
+            VM_NEXT();
+        }
+        VM_OP(CELL_LOAD)
+            --sp;
+            if (char const* const error{ heap.load(sp[-1], *sp, sp[-1]) }) return fail(error);
+            VM_NEXT();
+        VM_OP(CELL_STORE)
+            sp -= 3;
+            if (char const* const error{ heap.store(sp[0], sp[1], sp[2]) }) return fail(error);
+            VM_NEXT();
+        VM_OP(DELETE)
+            if (char const* const error{ heap.release(*--sp) }) return fail(error);
+            VM_NEXT();
+        VM_OP(PIN)
+            if (char const* const error{ heap.pin(*--sp) }) return fail(error);
+            VM_NEXT();
+#if !PANC_THREADED_DISPATCH
+        }
+        return false;
+#endif
+    }
+
+#undef VM_BINARY
+#undef VM_NEXT
+#undef VM_DISPATCH
+#undef VM_OP
+}
@@ -0,0 +1,80 @@
+#ifndef PANCVM_HPP
+#define PANCVM_HPP
+
+#include "pancast.hpp"
+#include "pancexpr.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace panc
+{
+    enum class Op : uint8_t
+    {
+        CONST,      // push arg
+        LOAD,       // push locals[arg]
+        STORE,      // locals[arg] = pop
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        EQ,
+        LT,
+        GT,
+        NEG,
+        PUSH,       // move top of operand stack onto the language value stack
+        POP,        // move top of the language value stack onto the operand stack
+        CALL,       // call functions[arg]; its arguments are the top params values
+        RET,
+        PRINT_STR,  // write string arg
+        PRINT_INT,  // write pop
+        PRINT_END,  // write newline
+        JUMP,       // continue at code[arg]
+        JUMP_IF,    // continue at code[arg] if pop is nonzero
+        DESTROY,    // discard the top of the language value stack
+        NEW,        // last = pop, first = pop; push a handle to zeroed cells first..last
+        CELL_LOAD,  // index = pop, handle = pop; push that cell
+        CELL_STORE, // value = pop, index = pop, handle = pop; store value in that cell
+        DELETE,     // free the cells of handle pop
+        PIN         // keep the cells of handle pop for the rest of the run
+    };
+
+    struct Instr
+    {
+        Op op;
+        int32_t arg;
+    };
+
+    // A compiled procedure: params arguments occupy the first local slots, and
+    // maxStack bounds the operand stack it needs above its locals.
+    struct Function
+    {
+        uint32_t name;
+        uint32_t entry;
+        uint32_t params;
+        uint32_t locals;
+        uint32_t maxStack;
+    };
+
+    struct Bytecode
+    {
+        std::vector<Instr> code{};
+        std::vector<Function> functions{};
+        uint32_t main{ 0 };
+    };
+
+    // Lowers every procedure to stack bytecode. The operand stack is empty at every
+    // jump and jump target, as statements leave nothing on it. Names are resolved here, so a
+    // duplicate or unknown procedure, a wrong argument count or a variable read before any
+    // assignment is reported as a compile error rather than when reached. A
+    // variable is only assigned after a loop if the loop assigns it outside its
+    // body, as the counter is, or its literal bounds show the body runs. A loop's
+    // body may not assign its counter, nor reuse it for an inner loop.
+    bool compile(Program const& program, StringTable const& strings, Bytecode& out);
+
+    // Runs main on a stack VM: direct-threaded through computed goto where the
+    // compiler supports it, otherwise a switch loop. Cells from new live in a
+    // Heap for the duration of the run.
+    bool run(Bytecode const& bytecode, StringTable const& strings);
+}
+
+#endif